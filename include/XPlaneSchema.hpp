@@ -0,0 +1,199 @@
+#ifndef XPLANESCHEMA_HPP
+#define XPLANESCHEMA_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+
+namespace eyderoe
+{
+constexpr size_t RREF_REQUEST_SIZE{413}; // RREF 请求固定长度 头部5 + 频率4 + 索引4 + 路径400
+constexpr size_t RREF_FREQ_OFFSET{5};
+constexpr size_t RREF_INDEX_OFFSET{9};
+constexpr size_t RREF_NAME_OFFSET{13};
+constexpr size_t RREF_NAME_LENGTH{400};
+
+/**
+ * @brief RREF 回包中的一项,固定布局
+ */
+struct RrefValue {
+    int32_t index;
+    float value;
+};
+static_assert(sizeof(RrefValue) == 8 && std::is_trivially_copyable_v<RrefValue>);
+
+/**
+ * @brief 可作为模板参数的字符串
+ */
+template <size_t N>
+struct FixedString {
+    char data[N]{};
+    constexpr FixedString (const char (&str)[N]) { std::copy_n(str, N, data); }
+    [[nodiscard]] constexpr size_t size () const { return N - 1; }
+    [[nodiscard]] constexpr std::string_view view () const { return {data, N - 1}; }
+};
+
+/**
+ * @brief 声明一组 dataref
+ * @tparam Name dataref 名称
+ * @tparam Length 长度,大于1时按数组订阅 name[i]
+ * @tparam T 帧中的存储类型
+ * @tparam Rate 固定频率,0表示使用运行时传入的频率
+ */
+template <FixedString Name, size_t Length = 1, typename T = float, int32_t Rate = 0>
+struct Dataref {
+    static constexpr std::string_view name{Name.view()};
+    static constexpr size_t length{Length};
+    static constexpr int32_t rate{Rate};
+    static constexpr bool isArray{Length > 1};
+    using type = T;
+
+    static_assert(Length > 0, "dataref length must be positive");
+    static_assert(std::is_arithmetic_v<T>, "dataref storage must be arithmetic");
+};
+
+/**
+ * @brief 十进制位数
+ */
+constexpr size_t digitCount (size_t value) {
+    size_t count{1};
+    while (value >= 10) {
+        value /= 10;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @brief 由一组 Dataref 生成槽位布局、RREF 请求包与 SoA 帧结构,全部在编译期完成
+ * @tparam Fields Dataref<...>
+ */
+template <typename... Fields>
+struct DatarefSchema {
+    static_assert(sizeof...(Fields) > 0, "empty schema");
+
+    static constexpr size_t count{sizeof...(Fields)};
+    static constexpr size_t slots{(Fields::length + ...)};
+    // 各组在槽位中的偏移
+    static constexpr std::array<size_t, count> offsets = [] {
+        std::array<size_t, count> result{};
+        size_t offset{0}, i{0};
+        ((result[i++] = offset, offset += Fields::length), ...);
+        return result;
+    }();
+    // 单个请求中路径部分的最长长度 name[i]
+    static constexpr size_t nameLength{
+        std::max({(Fields::name.size() + (Fields::isArray ? digitCount(Fields::length - 1) + 2 : 0))...})
+    };
+    static_assert(nameLength < RREF_NAME_LENGTH, "dataref name too long for RREF");
+    static constexpr size_t packetLength{RREF_NAME_OFFSET + nameLength + 1};
+
+    using Packet = std::array<char, packetLength>;
+
+    /**
+     * @brief SoA 帧,每组一列
+     */
+    struct Frame {
+        std::tuple<std::array<typename Fields::type, Fields::length>...> columns{};
+
+        template <typename Field>
+        auto& get () { return std::get<indexOf<Field>()>(columns); }
+        template <typename Field>
+        const auto& get () const { return std::get<indexOf<Field>()>(columns); }
+    };
+
+    template <typename Field>
+    static constexpr size_t indexOf () {
+        constexpr std::array<bool, count> match{std::is_same_v<Field, Fields>...};
+        static_assert(std::ranges::count(match, true) == 1, "field not in schema");
+        return std::ranges::find(match, true) - match.begin();
+    }
+
+    // 每个槽位的请求包(频率与全局索引在运行时填入)
+    static constexpr std::array<Packet, slots> packets = [] {
+        std::array<Packet, slots> result{};
+        size_t slot{0};
+        auto write = [&]<typename Field>() {
+            for (size_t i = 0; i < Field::length; ++i, ++slot) {
+                Packet &packet = result[slot];
+                constexpr std::string_view head{"RREF"};
+                std::ranges::copy(head, packet.begin());
+                size_t pos = RREF_NAME_OFFSET;
+                for (const char c : Field::name)
+                    packet[pos++] = c;
+                if constexpr (Field::isArray) {
+                    packet[pos++] = '[';
+                    const size_t digits = digitCount(i);
+                    for (size_t d = 0, value = i; d < digits; ++d, value /= 10)
+                        packet[pos + digits - 1 - d] = static_cast<char>('0' + value % 10);
+                    pos += digits;
+                    packet[pos] = ']';
+                }
+            }
+        };
+        (write.template operator()<Fields>(), ...);
+        return result;
+    }();
+    // 每个槽位的固定频率
+    static constexpr std::array<int32_t, slots> rates = [] {
+        std::array<int32_t, slots> result{};
+        size_t slot{0};
+        ((std::fill_n(result.begin() + slot, Fields::length, Fields::rate), slot += Fields::length), ...);
+        return result;
+    }();
+
+    /**
+     * @brief 写出某个槽位的 RREF 请求
+     * @param buffer 目标缓冲区(至少 RREF_REQUEST_SIZE,预先清零)
+     * @param slot 模式内槽位
+     * @param freq 运行时频率(组未指定频率时使用)
+     * @param index 全局索引
+     */
+    template <typename Buffer>
+    static void request (Buffer &buffer, const size_t slot, const int32_t freq, const int32_t index) {
+        static_assert(std::tuple_size_v<Buffer> >= RREF_REQUEST_SIZE);
+        const int32_t realFreq = (freq == 0 || rates[slot] == 0) ? freq : rates[slot];
+        std::memcpy(buffer.data(), packets[slot].data(), packetLength);
+        std::memcpy(buffer.data() + RREF_FREQ_OFFSET, &realFreq, sizeof(int32_t));
+        std::memcpy(buffer.data() + RREF_INDEX_OFFSET, &index, sizeof(int32_t));
+    }
+
+    /**
+     * @brief 依次访问每组 (Field, 偏移)
+     */
+    template <typename Func>
+    static void forEach (Func &&func) {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (func.template operator()<Fields>(offsets[I]), ...);
+        }(std::index_sequence_for<Fields...>{});
+    }
+
+    /**
+     * @brief 从连续槽位解码到帧,每组固定偏移拷贝
+     * @param values 槽位起始
+     * @param frame 目标帧
+     */
+    static void decode (const float *values, Frame &frame) {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (decodeColumn<I>(values + offsets[I], std::get<I>(frame.columns)), ...);
+        }(std::index_sequence_for<Fields...>{});
+    }
+
+    template <size_t I, typename Column>
+    static void decodeColumn (const float *source, Column &column) {
+        using T = typename Column::value_type;
+        if constexpr (std::is_same_v<T, float>)
+            std::memcpy(column.data(), source, sizeof(float) * column.size());
+        else
+            std::transform(source, source + column.size(), column.begin(),
+                           [](const float value) { return static_cast<T>(value); });
+    }
+};
+} // namespace eyderoe
+
+#endif
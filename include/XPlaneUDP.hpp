@@ -10,8 +10,11 @@
 #include <ranges>
 #include <memory>
 #include <array>
+#include <chrono>
 #include <shared_mutex>
 
+#include "XPlaneSchema.hpp"
+
 #ifdef _WIN32
 constexpr bool IS_WIN = true;
 #else
@@ -192,9 +195,13 @@ class XPlaneUdp {
         void setDataref (const std::string &dataref, float value, int index = -1);
         template <Container T>
         void setDataref (const std::string &dataref, const T &value);
+        template <typename Schema>
+        DatarefIndex addSchema (int32_t freq = 1);
+        template <typename Schema>
+        bool getSchema (const DatarefIndex &first, typename Schema::Frame &frame) const;
 
         void addPlaneInfo (int freq = 1);
-        void getPlaneInfo (PlaneInfo &infoDst) const;
+        bool getPlaneInfo (PlaneInfo &infoDst) const;
     private:
         struct DatarefInfo {
             std::string name; // dataref 长度
@@ -210,6 +217,7 @@ class XPlaneUdp {
         boost::dynamic_bitset<> space;
         std::unordered_map<std::string, size_t> exist;
         PlaneInfo info{.track = -999};
+        std::chrono::steady_clock::time_point infoTime; // 最近一次收到RPOS
         BufferPool pool{};
         mutable std::shared_mutex dataMutex;
         // 网络
@@ -456,10 +464,15 @@ inline void XPlaneUdp::addPlaneInfo (int freq) {
 
 /**
  * @brief 获取基本信息最新值
+ * @return 值可用(已收到,且距上次接收不超过2个接收周期,至少250ms)
  */
-inline void XPlaneUdp::getPlaneInfo (PlaneInfo &infoDst) const {
+inline bool XPlaneUdp::getPlaneInfo (PlaneInfo &infoDst) const {
     std::shared_lock lock(dataMutex);
     infoDst = info;
+    if ((info.track == -999) || (infoFreq <= 0))
+        return false;
+    const auto maxAge = std::chrono::milliseconds(std::max(2000 / infoFreq, 250));
+    return std::chrono::steady_clock::now() - infoTime <= maxAge;
 }
 
 /**
@@ -471,6 +484,10 @@ inline void XPlaneUdp::setState (const bool newState) {
         return;
     if (newState && autoReconnect)
         reconnect();
+    if (!newState) {
+        std::unique_lock lock(dataMutex);
+        info.track = -999; // 断开后不再沿用旧位置
+    }
     state = newState;
     if (callback)
         callback(newState);
@@ -573,20 +590,21 @@ inline void XPlaneUdp::receiveDataProcess (const std::shared_ptr<std::array<char
     if (size <= HEADER_LENGTH) // 头部大小
         return;
     if (compareHead(DATAREF_GET_HEAD, *data)) { // dataref
-        if ((size - 5) % 8 != 0)
+        if ((size - HEADER_LENGTH) % sizeof(RrefValue) != 0)
             return;
         std::unique_lock lock(dataMutex);
-        for (int i = HEADER_LENGTH; i < size; i += 8) {
-            int index;
-            float value;
-            unpack(*data, i, index, value);
-            values[index] = value;
+        for (size_t i = HEADER_LENGTH; i < size; i += sizeof(RrefValue)) {
+            RrefValue item;
+            std::memcpy(&item, data->data() + i, sizeof(RrefValue));
+            if ((item.index >= 0) && (item.index < values.size()))
+                values[item.index] = item.value;
         }
     } else if (compareHead(BASIC_INFO_HEAD, *data)) { // 基本信息
         if (((size - 5) % 64 != 0) || (size <= 6))
             return;
         std::unique_lock lock(dataMutex);
         unpack(*data, HEADER_LENGTH, info);
+        infoTime = std::chrono::steady_clock::now();
     } else if (compareHead(BECON_HEAD, *data)) { // 信标
         if (!xpSocket.is_open()) { // 第一次听见信标
             uint8_t mainVer, minorVer;
@@ -649,6 +667,47 @@ void XPlaneUdp::setDataref (const std::string &dataref, const T &value) {
         sendData(buffer, 509);
     }
 }
+/**
+ * @brief 按编译期模式新增一组监听目标,槽位连续分配,请求包直接取自模式
+ * @tparam Schema DatarefSchema<...>
+ * @param freq 频率(组内未指定频率时使用)
+ * @return 第一组的标识,用于 getSchema
+ */
+template <typename Schema>
+XPlaneUdp::DatarefIndex XPlaneUdp::addSchema (const int32_t freq) {
+    const size_t first = dataRefs.size();
+    const int start = static_cast<int>(findSpace(Schema::slots));
+    Schema::forEach([&]<typename Field>(const size_t offset) {
+        const int fieldStart = start + static_cast<int>(offset);
+        const int32_t fieldFreq = (Field::rate == 0) ? freq : Field::rate;
+        dataRefs.emplace_back(std::string(Field::name), fieldStart, fieldStart + static_cast<int>(Field::length) - 1,
+                              fieldFreq, true, Field::isArray);
+        exist[std::string(Field::name)] = dataRefs.size() - 1;
+    });
+    for (size_t i = 0; i < Schema::slots; ++i) {
+        const auto buffer = pool.getBuffer(RREF_REQUEST_SIZE);
+        Schema::request(*buffer, i, freq, start + static_cast<int32_t>(i));
+        sendData(buffer, RREF_REQUEST_SIZE);
+    }
+    return DatarefIndex{first};
+}
+
+/**
+ * @brief 获取一组模式数据,一次加锁,按固定偏移解码
+ * @param first addSchema 返回的标识
+ * @param frame 目标帧
+ * @return 值可用
+ * @note 组内的 dataref 不应再单独 changeDatarefFreq,否则槽位不再连续
+ */
+template <typename Schema>
+bool XPlaneUdp::getSchema (const DatarefIndex &first, typename Schema::Frame &frame) const {
+    std::shared_lock lock(dataMutex);
+    const auto &ref = dataRefs[first.getIdx()];
+    if (!ref.available)
+        return false;
+    Schema::decode(values.data() + ref.start, frame);
+    return true;
+}
 } // namespace eyderoe
 
 #endif
@@ -0,0 +1,784 @@
+#ifndef XPLANEWEB_HPP
+#define XPLANEWEB_HPP
+
+#include "XPlaneUDP.hpp"
+#include "json.hpp"
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <atomic>
+#include <charconv>
+#include <deque>
+#include <numeric>
+
+
+namespace eyderoe
+{
+static constexpr unsigned short WEB_API_PORT{8086};
+const static std::string WEB_API_PATH{"/api/v2"};
+const static std::string WEB_UPDATE_TYPE{"dataref_update_values"};
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+
+/**
+ * @brief 流式读取 Web API 推送帧,不构建 DOM
+ * @note 帧格式 {"type":"dataref_update_values","data":{"<id>":<数值|数组|base64>,...}}
+ */
+class WebFrameReader {
+    public:
+        explicit WebFrameReader (const std::string_view text) : text(text) {}
+        template <typename Func>
+        bool readUpdate (Func &&onValue);
+    private:
+        std::string_view text;
+        size_t pos{0};
+
+        void skipSpace ();
+        bool consume (char c);
+        bool readString (std::string_view &out);
+        bool readNumber (double &out);
+        bool skipValue ();
+        template <typename Func>
+        bool readData (Func &&onValue);
+        template <typename Func>
+        bool readBase64 (int64_t id, std::string_view encoded, Func &&onValue) const;
+};
+
+inline void WebFrameReader::skipSpace () {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t'))
+        ++pos;
+}
+
+inline bool WebFrameReader::consume (const char c) {
+    skipSpace();
+    if (pos >= text.size() || text[pos] != c)
+        return false;
+    ++pos;
+    return true;
+}
+
+/**
+ * @brief 读取字符串,返回引号内原始内容(不处理转义)
+ */
+inline bool WebFrameReader::readString (std::string_view &out) {
+    if (!consume('"'))
+        return false;
+    const size_t start = pos;
+    while (pos < text.size() && text[pos] != '"')
+        pos += (text[pos] == '\\') ? 2 : 1;
+    if (pos >= text.size())
+        return false;
+    out = text.substr(start, pos - start);
+    ++pos;
+    return true;
+}
+
+inline bool WebFrameReader::readNumber (double &out) {
+    skipSpace();
+    const char *begin = text.data() + pos;
+    const char *end = text.data() + text.size();
+    if ((begin != end) && (*begin == '+'))
+        ++begin;
+    const auto [ptr, ec] = std::from_chars(begin, end, out);
+    if (ec != std::errc{})
+        return false;
+    pos = ptr - text.data();
+    return true;
+}
+
+/**
+ * @brief 跳过任意值(对象/数组整体跳过,只追踪括号深度)
+ */
+inline bool WebFrameReader::skipValue () {
+    skipSpace();
+    if (pos >= text.size())
+        return false;
+    if (text[pos] == '"') {
+        std::string_view ignore;
+        return readString(ignore);
+    }
+    if ((text[pos] != '{') && (text[pos] != '[')) { // 数字 true false null
+        while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']')
+            ++pos;
+        return true;
+    }
+    int depth{0};
+    while (pos < text.size()) {
+        const char c = text[pos];
+        if (c == '"') {
+            std::string_view ignore;
+            if (!readString(ignore))
+                return false;
+            continue;
+        }
+        if ((c == '{') || (c == '['))
+            ++depth;
+        else if ((c == '}') || (c == ']'))
+            --depth;
+        ++pos;
+        if (depth == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 读取一帧更新
+ * @param onValue 回调 (id, 数组索引, 值)
+ * @return 是否为合法的 dataref 更新帧
+ * @note 先完整校验 data,通过后才回调;中途出错的帧不会写入任何值
+ */
+template <typename Func>
+bool WebFrameReader::readUpdate (Func &&onValue) {
+    if (!consume('{'))
+        return false;
+    std::string_view type, data;
+    if (consume('}'))
+        return false;
+    while (true) {
+        std::string_view key;
+        if (!readString(key) || !consume(':'))
+            return false;
+        if (key == "type") {
+            if (!readString(type))
+                return false;
+        } else if (key == "data") {
+            skipSpace();
+            const size_t start = pos;
+            if (!skipValue())
+                return false;
+            data = text.substr(start, pos - start);
+        } else if (!skipValue())
+            return false;
+        if (consume(','))
+            continue;
+        if (consume('}'))
+            break;
+        return false;
+    }
+    if ((type != WEB_UPDATE_TYPE) || data.empty())
+        return false;
+    if (WebFrameReader check(data); !check.readData([](int64_t, size_t, float) {}))
+        return false;
+    WebFrameReader inner(data);
+    return inner.readData(std::forward<Func>(onValue));
+}
+
+template <typename Func>
+bool WebFrameReader::readData (Func &&onValue) {
+    if (!consume('{'))
+        return false;
+    if (consume('}'))
+        return true;
+    while (true) {
+        std::string_view key;
+        if (!readString(key) || !consume(':'))
+            return false;
+        int64_t id{};
+        if (std::from_chars(key.data(), key.data() + key.size(), id).ec != std::errc{})
+            return false;
+        skipSpace();
+        if (pos >= text.size())
+            return false;
+        if (text[pos] == '[') { // 数组
+            ++pos;
+            size_t idx{0};
+            if (!consume(']')) {
+                do {
+                    double value;
+                    if (!readNumber(value))
+                        return false;
+                    onValue(id, idx++, static_cast<float>(value));
+                } while (consume(','));
+                if (!consume(']'))
+                    return false;
+            }
+        } else if (text[pos] == '"') { // 字节数组 base64
+            std::string_view encoded;
+            if (!readString(encoded) || !readBase64(id, encoded, onValue))
+                return false;
+        } else { // 单值
+            double value;
+            if (!readNumber(value))
+                return false;
+            onValue(id, 0, static_cast<float>(value));
+        }
+        if (consume(','))
+            continue;
+        return consume('}');
+    }
+}
+
+/**
+ * @brief 解码 base64 字节数组,每字节视为一个值(与 UDP 下 byte 数组行为一致)
+ */
+template <typename Func>
+bool WebFrameReader::readBase64 (const int64_t id, const std::string_view encoded, Func &&onValue) const {
+    auto decode = [](const char c) -> int {
+        if (c >= 'A' && c <= 'Z')
+            return c - 'A';
+        if (c >= 'a' && c <= 'z')
+            return c - 'a' + 26;
+        if (c >= '0' && c <= '9')
+            return c - '0' + 52;
+        if (c == '+')
+            return 62;
+        if (c == '/')
+            return 63;
+        return -1;
+    };
+    uint32_t buffer{0};
+    int bits{0};
+    size_t idx{0};
+    for (const char c : encoded) {
+        if (c == '=')
+            break;
+        const int value = decode(c);
+        if (value < 0)
+            return false;
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            onValue(id, idx++, static_cast<float>((buffer >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief XPlane 12 本地 Web API 客户端 (REST + WebSocket)
+ * @note 接口与 XPlaneUdp 保持一致;数组按 id 整体订阅,推送频率由 XPlane 决定(约10Hz),freq 仅作记录
+ */
+class XPlaneWeb {
+    public:
+        using DatarefIndex = XPlaneUdp::DatarefIndex;
+
+        explicit XPlaneWeb (std::string host = "127.0.0.1", unsigned short port = WEB_API_PORT,
+                            bool autoReConnect = true);
+        ~XPlaneWeb ();
+        XPlaneWeb (const XPlaneWeb &) = delete;
+        XPlaneWeb& operator= (const XPlaneWeb &) = delete;
+        XPlaneWeb (XPlaneWeb &&) = delete;
+        XPlaneWeb& operator= (XPlaneWeb &&) = delete;
+
+        void setCallback (const std::function<void  (bool)> &callbackFunc);
+        void reconnect (bool del = false);
+        void stop ();
+        void close ();
+
+        DatarefIndex addDataref (const std::string &dataref, int32_t freq = 1, int index = -1);
+        DatarefIndex addDatarefArray (const std::string &dataref, int length, int32_t freq = 1);
+        bool getDataref (const DatarefIndex &dataref, float &value, float defaultValue = 0) const;
+        template <Container T>
+        bool getDataref (const DatarefIndex &dataref, T &container, float defaultValue = 0);
+        void setDataref (const std::string &dataref, float value, int index = -1);
+        template <typename Schema>
+        DatarefIndex addSchema (int32_t freq = 1);
+        template <typename Schema>
+        bool getSchema (const DatarefIndex &first, typename Schema::Frame &frame) const;
+    private:
+        struct DatarefInfo {
+            std::string name; // dataref 名称(不含索引)
+            int start, end; // values中索引,[start,end]
+            int index; // 单元素订阅时的数组索引,-1表示整体
+            int64_t id; // Web API 中的 id,-1表示未解析
+            int32_t freq; // 频率
+            bool isArray; // 是否是数组
+        };
+        /**
+         * 同一 id 可对应多个订阅(如 foo[0] 与 foo[3],或数组与其中一个元素),推送按此分发给每一个
+         */
+        struct IdRoute {
+            std::vector<size_t> refs; // dataRefs索引
+            std::vector<int> indices; // 按元素订阅时推送数组各位置对应的数组索引,空表示整体订阅
+        };
+
+        // 数据
+        std::vector<DatarefInfo> dataRefs;
+        std::vector<float> values;
+        std::unordered_map<std::string, size_t> exist;
+        std::unordered_map<int64_t, IdRoute> idRoutes; // id -> 订阅
+        mutable std::shared_mutex dataMutex; // dataRefs/values/idRoutes,io 线程读取同样需要加锁
+        // 网络
+        std::string host;
+        unsigned short port;
+        bool autoReconnect; // 自动重连
+        std::atomic_bool closed{false};
+        int64_t reqId{0};
+        asio::io_context io_context{}; // 上下文
+        asio::executor_work_guard<asio::io_context::executor_type> workGuard;
+        std::unique_ptr<websocket::stream<beast::tcp_stream>> ws; // 仅在 io 线程访问
+        std::deque<std::string> outbox; // 待发送消息,同一时刻只允许一个 async_write
+        std::thread worker; // io_content驱动
+        // 回调
+        bool state{false}; // xp状态
+        std::function<void  (bool)> callback{nullptr}; // 回调
+
+        size_t appendRef (const std::string &dataref, int length, int index, int32_t freq, bool isArray);
+        void setState (bool newState);
+        asio::awaitable<void> session ();
+        asio::awaitable<void> resolveIds (std::vector<size_t> refs);
+        asio::awaitable<void> flush ();
+        void post (std::string message);
+        std::string subscribeMessage (const std::vector<int64_t> &ids);
+        void receiveDataProcess (std::string_view frame);
+};
+
+inline XPlaneWeb::XPlaneWeb (std::string host, const unsigned short port, const bool autoReConnect) :
+    host(std::move(host)), port(port), autoReconnect(autoReConnect), workGuard(asio::make_work_guard(io_context)),
+    worker([this] () { io_context.run(); }) {
+    asio::co_spawn(io_context, session(), asio::detached);
+}
+
+inline XPlaneWeb::~XPlaneWeb () {
+    close();
+}
+
+/**
+ * @brief 设置一个回调函数,xp连接状态改变时会调用
+ * @param callbackFunc 回调函数 接受形参bool
+ */
+inline void XPlaneWeb::setCallback (const std::function<void  (bool)> &callbackFunc) {
+    callback = callbackFunc;
+}
+
+/**
+ * @brief 重新订阅全部 dataref
+ * @param del 为 true 时取消全部订阅
+ */
+inline void XPlaneWeb::reconnect (const bool del) {
+    asio::post(io_context, [this, del] {
+        if (!ws)
+            return;
+        if (del) {
+            post(std::format(R"({{"req_id":{},"type":"dataref_unsubscribe_values","params":{{"datarefs":"all"}}}})",
+                             ++reqId));
+            return;
+        }
+        std::vector<size_t> refs;
+        {
+            std::shared_lock lock(dataMutex);
+            refs.resize(dataRefs.size());
+        }
+        std::iota(refs.begin(), refs.end(), 0);
+        asio::co_spawn(io_context, resolveIds(std::move(refs)), asio::detached);
+    });
+}
+
+/**
+ * @brief 停止所有订阅
+ */
+inline void XPlaneWeb::stop () {
+    reconnect(true);
+}
+
+/**
+ * @brief 彻底关闭连接
+ */
+inline void XPlaneWeb::close () {
+    if (closed.exchange(true))
+        return;
+    asio::post(io_context, [this] {
+        if (ws) {
+            boost::system::error_code ec;
+            beast::get_lowest_layer(*ws).socket().close(ec);
+        }
+        workGuard.reset();
+        io_context.stop();
+    });
+    if (worker.joinable())
+        worker.join();
+}
+
+/**
+ * @brief 新增监听目标
+ * @param dataref dataref 名称
+ * @param freq 频率
+ * @param index 目标为数组时的索引
+ */
+inline XPlaneWeb::DatarefIndex XPlaneWeb::addDataref (const std::string &dataref, int32_t freq, int index) {
+    const std::string name = (index == -1) ? dataref : std::format("{}[{}]", dataref, index);
+    if (const auto it = exist.find(name); it != exist.end()) {
+        std::cerr << "already exist! nothing change.";
+        return DatarefIndex{it->second};
+    }
+    size_t ref;
+    {
+        std::unique_lock lock(dataMutex);
+        ref = appendRef(dataref, 1, index, freq, false);
+    }
+    exist[name] = ref;
+    asio::post(io_context, [this, ref] {
+        if (ws)
+            asio::co_spawn(io_context, resolveIds({ref}), asio::detached);
+    });
+    return DatarefIndex{ref};
+}
+
+/**
+ * @brief 新增监听目标,目标为数组(一次订阅整个数组)
+ * @param dataref dataref 名称
+ * @param length 数组长度
+ * @param freq 频率
+ */
+inline XPlaneWeb::DatarefIndex XPlaneWeb::addDatarefArray (const std::string &dataref, const int length,
+                                                           int32_t freq) {
+    if (const auto it = exist.find(dataref); it != exist.end()) {
+        std::cerr << "already exist! nothing change.";
+        return DatarefIndex{it->second};
+    }
+    size_t ref;
+    {
+        std::unique_lock lock(dataMutex);
+        ref = appendRef(dataref, length, -1, freq, true);
+    }
+    exist[dataref] = ref;
+    asio::post(io_context, [this, ref] {
+        if (ws)
+            asio::co_spawn(io_context, resolveIds({ref}), asio::detached);
+    });
+    return DatarefIndex{ref};
+}
+
+/**
+ * @brief 获取 dataref 最新值
+ * @param dataref 标识
+ * @param value 返回值
+ * @param defaultValue 默认值
+ * @return 值可用
+ */
+inline bool XPlaneWeb::getDataref (const DatarefIndex &dataref, float &value, const float defaultValue) const {
+    std::shared_lock lock(dataMutex);
+    const auto &ref = dataRefs[dataref.getIdx()];
+    if (ref.id < 0) {
+        value = defaultValue;
+        return false;
+    }
+    value = values[ref.start];
+    return true;
+}
+
+/**
+ * @brief 获取 dataref 最新值
+ * @param dataref 标识
+ * @param container 容器
+ * @param defaultValue 默认值
+ * @return 值可用
+ */
+template <Container T>
+bool XPlaneWeb::getDataref (const DatarefIndex &dataref, T &container, const float defaultValue) {
+    std::shared_lock lock(dataMutex);
+    const auto &ref = dataRefs[dataref.getIdx()];
+    const size_t size = std::min<size_t>(ref.end - ref.start + 1, std::ranges::size(container));
+    if (ref.id < 0) {
+        std::ranges::fill(container | std::views::take(size), defaultValue);
+        return false;
+    }
+    std::ranges::copy(values | std::views::drop(ref.start) | std::views::take(size), container.begin());
+    return true;
+}
+
+/**
+ * @brief 按编译期模式新增一组监听目标,每组整体订阅
+ * @tparam Schema DatarefSchema<...>
+ * @param freq 频率
+ * @return 第一组的标识,用于 getSchema
+ * @note 各组总是新建(即使同名目标已存在,同一 id 的推送会分发给每一个),保证同一模式内槽位连续
+ */
+template <typename Schema>
+XPlaneWeb::DatarefIndex XPlaneWeb::addSchema (const int32_t freq) {
+    size_t first;
+    {
+        std::unique_lock lock(dataMutex);
+        first = dataRefs.size();
+        Schema::forEach([&]<typename Field>(size_t) {
+            appendRef(std::string(Field::name), static_cast<int>(Field::length), -1, freq, Field::isArray);
+        });
+    }
+    std::vector<size_t> refs(Schema::count);
+    std::iota(refs.begin(), refs.end(), first);
+    asio::post(io_context, [this, refs = std::move(refs)] {
+        if (ws)
+            asio::co_spawn(io_context, resolveIds(refs), asio::detached);
+    });
+    return DatarefIndex{first};
+}
+
+/**
+ * @brief 获取一组模式数据,一次加锁,按固定偏移解码
+ * @param first addSchema 返回的标识
+ * @param frame 目标帧
+ * @return 值可用(每一组都已解析)
+ */
+template <typename Schema>
+bool XPlaneWeb::getSchema (const DatarefIndex &first, typename Schema::Frame &frame) const {
+    std::shared_lock lock(dataMutex);
+    if (first.getIdx() + Schema::count > dataRefs.size())
+        return false;
+    for (size_t i = 0; i < Schema::count; ++i)
+        if (dataRefs[first.getIdx() + i].id < 0)
+            return false;
+    Schema::decode(values.data() + dataRefs[first.getIdx()].start, frame);
+    return true;
+}
+
+/**
+ * @brief 设置dataref值
+ * @param dataref dataref 名称
+ * @param value 值
+ * @param index 目标为数组时的索引
+ */
+inline void XPlaneWeb::setDataref (const std::string &dataref, const float value, const int index) {
+    asio::co_spawn(io_context, [this, dataref, value, index] () -> asio::awaitable<void> {
+        // 复用订阅表中的 id,没有则临时解析
+        int64_t id{-1};
+        {
+            std::shared_lock lock(dataMutex);
+            for (const auto &ref : dataRefs)
+                if ((ref.name == dataref) && (ref.id >= 0))
+                    id = ref.id;
+        }
+        if (id < 0) {
+            beast::tcp_stream stream(io_context);
+            asio::ip::tcp::resolver resolver(io_context);
+            const auto endpoints = co_await resolver.async_resolve(host, std::to_string(port), asio::use_awaitable);
+            co_await stream.async_connect(endpoints, asio::use_awaitable);
+            http::request<http::empty_body> request{
+                http::verb::get, std::format("{}/datarefs?filter%5Bname%5D={}&fields=id", WEB_API_PATH, dataref), 11
+            };
+            request.set(http::field::host, host);
+            co_await http::async_write(stream, request, asio::use_awaitable);
+            beast::flat_buffer buffer;
+            http::response<http::string_body> response;
+            co_await http::async_read(stream, buffer, response, asio::use_awaitable);
+            const auto body = nlohmann::json::parse(response.body(), nullptr, false);
+            if (body.is_discarded() || !body.contains("data") || body["data"].empty())
+                co_return;
+            id = body["data"][0]["id"].get<int64_t>();
+        }
+        if (index == -1)
+            post(std::format(R"({{"req_id":{},"type":"dataref_set_values","params":{{"datarefs":[{{"id":{},"value":{}}}]}}}})",
+                             ++reqId, id, value));
+        else
+            post(std::format(R"({{"req_id":{},"type":"dataref_set_values","params":{{"datarefs":[{{"id":{},"index":{},"value":{}}}]}}}})",
+                             ++reqId, id, index, value));
+    }, asio::detached);
+}
+
+/**
+ * @brief 追加一个监听目标及其槽位(调用方持有写锁)
+ * @return dataRefs索引
+ */
+inline size_t XPlaneWeb::appendRef (const std::string &dataref, const int length, const int index, const int32_t freq,
+                                    const bool isArray) {
+    const int start = static_cast<int>(values.size());
+    values.resize(values.size() + length);
+    dataRefs.emplace_back(dataref, start, start + length - 1, index, -1, freq, isArray);
+    return dataRefs.size() - 1;
+}
+
+/**
+ * @brief 设置xp状态 触发回调
+ * @param newState 新状态
+ */
+inline void XPlaneWeb::setState (const bool newState) {
+    if (newState == state)
+        return;
+    state = newState;
+    if (callback)
+        callback(newState);
+}
+
+/**
+ * @brief 连接主循环:握手 -> 解析id并订阅 -> 接收,断开后2秒重试
+ */
+inline asio::awaitable<void> XPlaneWeb::session () {
+    asio::steady_timer timer(co_await asio::this_coro::executor);
+    asio::ip::tcp::resolver resolver(io_context);
+    while (!closed) {
+        try {
+            const auto endpoints = co_await resolver.async_resolve(host, std::to_string(port), asio::use_awaitable);
+            // 握手完成前不暴露给 ws,期间新增的目标由下面的整体解析覆盖,不会在握手中途写入
+            auto stream = std::make_unique<websocket::stream<beast::tcp_stream>>(io_context);
+            co_await beast::get_lowest_layer(*stream).async_connect(endpoints, asio::use_awaitable);
+            beast::get_lowest_layer(*stream).expires_never();
+            co_await stream->async_handshake(std::format("{}:{}", host, port), WEB_API_PATH, asio::use_awaitable);
+            ws = std::move(stream);
+            setState(true);
+            {
+                // 连接前(或断开期间)新增的目标在此统一解析并订阅
+                std::vector<size_t> refs;
+                {
+                    std::shared_lock lock(dataMutex);
+                    refs.resize(dataRefs.size());
+                }
+                std::iota(refs.begin(), refs.end(), 0);
+                asio::co_spawn(io_context, resolveIds(std::move(refs)), asio::detached);
+            }
+            beast::flat_buffer buffer;
+            while (true) {
+                co_await ws->async_read(buffer, asio::use_awaitable);
+                if (ws->got_text()) {
+                    const auto data = buffer.cdata();
+                    receiveDataProcess({static_cast<const char*>(data.data()), data.size()});
+                }
+                buffer.consume(buffer.size());
+            }
+        } catch (const boost::system::system_error &) {}
+        ws.reset();
+        outbox.clear();
+        {
+            std::unique_lock lock(dataMutex);
+            for (auto &ref : dataRefs)
+                ref.id = -1;
+            idRoutes.clear();
+        }
+        setState(false);
+        if (closed || !autoReconnect)
+            break;
+        timer.expires_after(std::chrono::seconds(2));
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+}
+
+/**
+ * @brief 通过 REST 接口把名称解析为 id,再一次性订阅
+ * @param refs dataRefs 索引列表
+ */
+inline asio::awaitable<void> XPlaneWeb::resolveIds (const std::vector<size_t> refs) {
+    if (refs.empty())
+        co_return;
+    try {
+        // 一次请求查询全部名称
+        std::string target = std::format("{}/datarefs?fields=id,name", WEB_API_PATH);
+        {
+            std::shared_lock lock(dataMutex);
+            for (const auto ref : refs)
+                target += std::format("&filter%5Bname%5D={}", dataRefs[ref].name);
+        }
+        asio::ip::tcp::resolver resolver(io_context);
+        beast::tcp_stream stream(io_context);
+        const auto endpoints = co_await resolver.async_resolve(host, std::to_string(port), asio::use_awaitable);
+        co_await stream.async_connect(endpoints, asio::use_awaitable);
+        http::request<http::empty_body> request{http::verb::get, target, 11};
+        request.set(http::field::host, host);
+        co_await http::async_write(stream, request, asio::use_awaitable);
+        beast::flat_buffer buffer;
+        http::response<http::string_body> response;
+        co_await http::async_read(stream, buffer, response, asio::use_awaitable);
+        const auto body = nlohmann::json::parse(response.body(), nullptr, false);
+        if (body.is_discarded() || !body.contains("data"))
+            co_return;
+        // 写回 id
+        std::vector<int64_t> ids;
+        {
+            std::unique_lock lock(dataMutex);
+            for (const auto &item : body["data"]) {
+                const auto name = item["name"].get<std::string>();
+                const auto id = item["id"].get<int64_t>();
+                for (const auto ref : refs) {
+                    if (dataRefs[ref].name != name)
+                        continue;
+                    dataRefs[ref].id = id;
+                    if (auto &route = idRoutes[id]; std::ranges::find(route.refs, ref) == route.refs.end())
+                        route.refs.push_back(ref);
+                    if (std::ranges::find(ids, id) == ids.end())
+                        ids.push_back(id);
+                }
+            }
+        }
+        if (!ids.empty() && ws)
+            post(subscribeMessage(ids));
+    } catch (const boost::system::system_error &) {}
+}
+
+/**
+ * @brief 生成订阅消息,每个 id 按其全部订阅合并为一项(重复订阅同一 id 时以最后一次的索引为准)
+ * @param ids 需要(重新)订阅的 id
+ * @note 有整体订阅时整体订阅,否则订阅各元素索引的并集;同时更新推送位置到数组索引的对应关系
+ */
+inline std::string XPlaneWeb::subscribeMessage (const std::vector<int64_t> &ids) {
+    std::unique_lock lock(dataMutex);
+    std::string list;
+    for (const auto id : ids) {
+        auto &route = idRoutes[id];
+        route.indices.clear();
+        bool whole{false};
+        for (const auto ref : route.refs) {
+            whole |= dataRefs[ref].index == -1;
+            route.indices.push_back(dataRefs[ref].index);
+        }
+        std::ranges::sort(route.indices);
+        const auto [first, last] = std::ranges::unique(route.indices);
+        route.indices.erase(first, last);
+        if (!list.empty())
+            list += ',';
+        if (whole) {
+            route.indices.clear();
+            list += std::format(R"({{"id":{}}})", id);
+            continue;
+        }
+        std::string indices;
+        for (const int index : route.indices)
+            indices += std::format("{}{}", indices.empty() ? "" : ",", index);
+        list += std::format(R"({{"id":{},"index":[{}]}})", id, indices);
+    }
+    return std::format(R"({{"req_id":{},"type":"dataref_subscribe_values","params":{{"datarefs":[{}]}}}})", ++reqId,
+                       list);
+}
+
+/**
+ * @brief 排队发送一条消息(只能在 io 线程调用)
+ */
+inline void XPlaneWeb::post (std::string message) {
+    outbox.emplace_back(std::move(message));
+    if (outbox.size() == 1)
+        asio::co_spawn(io_context, flush(), asio::detached);
+}
+
+inline asio::awaitable<void> XPlaneWeb::flush () {
+    try {
+        while (!outbox.empty() && ws) {
+            ws->text(true);
+            co_await ws->async_write(asio::buffer(outbox.front()), asio::use_awaitable);
+            outbox.pop_front();
+        }
+    } catch (const boost::system::system_error &) {
+        outbox.clear();
+    }
+}
+
+/**
+ * @brief 处理一帧推送,直接写入 values
+ * @param frame 文本帧
+ */
+inline void XPlaneWeb::receiveDataProcess (const std::string_view frame) {
+    std::unique_lock lock(dataMutex);
+    WebFrameReader reader(frame);
+    reader.readUpdate([this](const int64_t id, const size_t idx, const float value) {
+        const auto it = idRoutes.find(id);
+        if (it == idRoutes.end())
+            return;
+        // 推送位置 -> 数组索引
+        const auto &route = it->second;
+        if (!route.indices.empty() && (idx >= route.indices.size()))
+            return;
+        const size_t arrayIndex = route.indices.empty() ? idx : static_cast<size_t>(route.indices[idx]);
+        for (const auto refIndex : route.refs) {
+            const auto &ref = dataRefs[refIndex];
+            if (ref.index == -1) {
+                if (arrayIndex <= static_cast<size_t>(ref.end - ref.start))
+                    values[ref.start + arrayIndex] = value;
+            } else if (static_cast<size_t>(ref.index) == arrayIndex)
+                values[ref.start] = value;
+        }
+    });
+}
+} // namespace eyderoe
+
+#endif
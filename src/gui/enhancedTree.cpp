@@ -1,14 +1,169 @@
 #include "enhancedTree.hpp"
 
-Node::Node (QString baseDir, const QString &name, const bool isFolder) : baseDir(std::move(baseDir)),
-                                                                         isFolder(isFolder) {
-    setText(0, name);
-    if (isFolder)
-        setForeground(0, QBrush(QColor(92, 145, 232))); // 很好看的蓝色
-    else {
-        if (this->baseDir.endsWith(".pdf", Qt::CaseInsensitive)) // 是PDF文件的话
-            setForeground(0, QBrush(QColor(232, 135, 92))); // 很好看的橙色
-        else
-            setForeground(0, QBrush(QColor(55, 139, 53))); // 很好看的绿色
+#include <boost/asio/post.hpp>
+
+#include "tools/threadPool.hpp"
+
+ChartTreeModel::ChartTreeModel (QObject *parent) : QAbstractItemModel(parent) {
+    scanGuard = std::make_shared<ScanGuard>();
+    scanGuard->model = this;
+}
+
+ChartTreeModel::~ChartTreeModel () {
+    const std::lock_guard lock(scanGuard->mutex);
+    scanGuard->model = nullptr;
+}
+
+/**
+ * @brief 切换根目录(只建根节点,子节点在视图请求时后台读取)
+ * @param folder 航图文件夹
+ * @param delNonePdf 是否丢弃非PDF文件
+ */
+void ChartTreeModel::setRoot (const QString &folder, const bool delNonePdf) {
+    beginResetModel();
+    ++generation;
+    this->delNonePdf = delNonePdf;
+    root.reset();
+    if (!folder.isEmpty())
+        root = std::make_unique<Node>(Node{folder, QFileInfo(folder).completeBaseName(), true});
+    endResetModel();
+    fetchMore({}); // 根目录立即开始读取
+}
+
+/**
+ * @brief 节点对应的文件或目录路径(占位节点为空)
+ */
+QString ChartTreeModel::filePath (const QModelIndex &index) const {
+    const Node *node = nodeOf(index);
+    return (node && index.isValid()) ? node->baseDir : QString{};
+}
+
+bool ChartTreeModel::isFolder (const QModelIndex &index) const {
+    const Node *node = nodeOf(index);
+    return node && index.isValid() && node->isFolder;
+}
+
+QModelIndex ChartTreeModel::index (const int row, const int column, const QModelIndex &parent) const {
+    const Node *node = nodeOf(parent);
+    if (!node || (row < 0) || (column != 0) || (row >= static_cast<int>(node->children.size())))
+        return {};
+    return createIndex(row, column, node->children[row].get());
+}
+
+QModelIndex ChartTreeModel::parent (const QModelIndex &child) const {
+    if (!child.isValid())
+        return {};
+    return indexOf(static_cast<Node*>(child.internalPointer())->parent);
+}
+
+int ChartTreeModel::rowCount (const QModelIndex &parent) const {
+    const Node *node = nodeOf(parent);
+    return node ? static_cast<int>(node->children.size()) : 0;
+}
+
+int ChartTreeModel::columnCount (const QModelIndex &) const {
+    return 1;
+}
+
+QVariant ChartTreeModel::data (const QModelIndex &index, const int role) const {
+    const Node *node = nodeOf(index);
+    if (!node || !index.isValid())
+        return {};
+    if (role == Qt::DisplayRole)
+        return node->name;
+    if (role == Qt::ForegroundRole) {
+        if (node->isFolder)
+            return QBrush(QColor(92, 145, 232)); // 很好看的蓝色
+        if (node->baseDir.endsWith(".pdf", Qt::CaseInsensitive)) // 是PDF文件的话
+            return QBrush(QColor(232, 135, 92)); // 很好看的橙色
+        return QBrush(QColor(55, 139, 53)); // 很好看的绿色
+    }
+    return {};
+}
+
+/**
+ * @brief 未读取的目录视为有子节点(显示展开箭头),展开时再读取
+ */
+bool ChartTreeModel::hasChildren (const QModelIndex &parent) const {
+    const Node *node = nodeOf(parent);
+    if (!node || !node->isFolder)
+        return false;
+    return (node->state != State::Loaded) || !node->children.empty();
+}
+
+bool ChartTreeModel::canFetchMore (const QModelIndex &parent) const {
+    const Node *node = nodeOf(parent);
+    return node && node->isFolder && (node->state == State::Unloaded);
+}
+
+/**
+ * @brief 在线程池中读取目录,完成后回到界面线程插入
+ */
+void ChartTreeModel::fetchMore (const QModelIndex &parent) {
+    Node *node = nodeOf(parent);
+    if (!node || !node->isFolder || (node->state != State::Unloaded))
+        return;
+    node->state = State::Loading;
+    boost::asio::post(sharedPool(), [guard = scanGuard, node, folder = node->baseDir, delNonePdf = delNonePdf,
+                          scanGeneration = generation] {
+        auto entries = readFolder(folder, delNonePdf);
+        const std::lock_guard lock(guard->mutex);
+        if (guard->model == nullptr)
+            return;
+        QMetaObject::invokeMethod(guard->model, [model = guard->model, scanGeneration, node,
+                                      entries = std::move(entries)] () mutable {
+            model->scanned(scanGeneration, node, std::move(entries));
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief 空索引对应根节点
+ */
+ChartTreeModel::Node* ChartTreeModel::nodeOf (const QModelIndex &index) const {
+    return index.isValid() ? static_cast<Node*>(index.internalPointer()) : root.get();
+}
+
+QModelIndex ChartTreeModel::indexOf (Node *node) const {
+    if (!node || (node == root.get()))
+        return {};
+    return createIndex(node->row, 0, node);
+}
+
+/**
+ * @brief 读取一层目录(不递归),目录项的类型随枚举一并取得
+ * @param folder 目录
+ * @param delNonePdf 是否丢弃非PDF文件
+ */
+std::vector<ChartTreeModel::Entry> ChartTreeModel::readFolder (const QString &folder, const bool delNonePdf) {
+    std::vector<Entry> entries;
+    const QFileInfoList infos = QDir(folder).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot,
+                                                           QDir::Name | QDir::IgnoreCase);
+    entries.reserve(infos.size());
+    for (const auto &info : infos) {
+        if (info.isFile() && delNonePdf && !info.fileName().endsWith(".pdf", Qt::CaseInsensitive))
+            continue;
+        entries.push_back({info.filePath(), info.completeBaseName(), !info.isFile()});
+    }
+    return entries;
+}
+
+/**
+ * @brief 目录读取完成(界面线程),根目录已切换时丢弃
+ */
+void ChartTreeModel::scanned (const uint64_t scanGeneration, Node *node, std::vector<Entry> entries) {
+    if (scanGeneration != generation)
+        return;
+    if (entries.empty())
+        entries.push_back({{}, "[Empty!]", false});
+    beginInsertRows(indexOf(node), 0, static_cast<int>(entries.size()) - 1);
+    node->children.reserve(entries.size());
+    for (auto &entry : entries) {
+        auto child = std::make_unique<Node>(Node{std::move(entry.baseDir), std::move(entry.name), entry.isFolder});
+        child->parent = node;
+        child->row = static_cast<int>(node->children.size());
+        node->children.push_back(std::move(child));
     }
+    node->state = State::Loaded;
+    endInsertRows();
 }
@@ -1,58 +1,62 @@
 #ifndef CHARTNAVIGATION_ENHANCEDTREE_HPP
 #define CHARTNAVIGATION_ENHANCEDTREE_HPP
 
-template <typename T>
-concept NodeT = std::is_base_of_v<QTreeWidgetItem, T> || std::is_base_of_v<QTreeWidget, T>;
+#include <QAbstractItemModel>
+#include <memory>
+#include <mutex>
+#include <vector>
 
-class Node;
-template <typename NodeT>
-void traverseRead (const QDir &folder, NodeT *parentNode, bool delNonePdf);
+/**
+ * 航图文件树模型
+ * 目录在展开时才读取(canFetchMore/fetchMore),读取在线程池中进行,完成后回到界面线程插入子节点
+ */
+class ChartTreeModel final : public QAbstractItemModel {
+        Q_OBJECT
+    public:
+        explicit ChartTreeModel (QObject *parent = nullptr);
+        ~ChartTreeModel () override;
 
+        void setRoot (const QString &folder, bool delNonePdf);
+        [[nodiscard]] QString filePath (const QModelIndex &index) const;
+        [[nodiscard]] bool isFolder (const QModelIndex &index) const;
 
-class Node final : public QTreeWidgetItem {
-    public:
-        Node () = default;
-        Node (QString baseDir, const QString &name, bool isFolder);
+        [[nodiscard]] QModelIndex index (int row, int column, const QModelIndex &parent) const override;
+        [[nodiscard]] QModelIndex parent (const QModelIndex &child) const override;
+        [[nodiscard]] int rowCount (const QModelIndex &parent) const override;
+        [[nodiscard]] int columnCount (const QModelIndex &parent) const override;
+        [[nodiscard]] QVariant data (const QModelIndex &index, int role) const override;
+        [[nodiscard]] bool hasChildren (const QModelIndex &parent) const override;
+        [[nodiscard]] bool canFetchMore (const QModelIndex &parent) const override;
+        void fetchMore (const QModelIndex &parent) override;
+    private:
+        enum class State { Unloaded, Loading, Loaded };
+        struct Node {
+            QString baseDir; // 文件或目录路径(占位节点为空)
+            QString name;
+            bool isFolder{};
+            Node *parent{nullptr};
+            int row{0};
+            State state{State::Unloaded};
+            std::vector<std::unique_ptr<Node>> children;
+        };
+        struct Entry {
+            QString baseDir, name;
+            bool isFolder;
+        };
+        struct ScanGuard {
+            std::mutex mutex;
+            ChartTreeModel *model;
+        };
 
-        QString baseDir; // 文件或目录路径
-        bool isFolder{}; // 类型(0文件1目录)
-};
+        std::unique_ptr<Node> root;
+        bool delNonePdf{true};
+        uint64_t generation{0}; // 切换根目录时递增,旧的读取结果被丢弃
+        std::shared_ptr<ScanGuard> scanGuard; // 析构后后台读取不再回调
 
-/**
- * @brief 递归新建树节点
- * @tparam NodeT 父节点类,根数或节点
- * @param folder 父文件夹
- * @param parentNode 父节点
- * @param delNonePdf 是否丢弃非PDF文件
- */
-template <typename NodeT>
-void traverseRead (const QDir &folder, NodeT *parentNode, const bool delNonePdf) {
-    // 获取子文件夹/文件
-    QStringList files = folder.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
-    std::vector<Node*> nodes;
-    for (auto &fileName : files) {
-        QString child{folder.filePath(fileName)};
-        if (QFileInfo info(child); info.isFile()) {
-            if (!child.endsWith(".pdf", Qt::CaseInsensitive) && delNonePdf)
-                continue;
-            nodes.emplace_back(new Node(child, info.completeBaseName(), false));
-        } else
-            nodes.emplace_back(new Node(child, info.completeBaseName(), true));
-    }
-    // 添加
-    if (nodes.empty())
-        nodes.emplace_back(new Node({}, {"[Empty!]"}, false));
-    for (const auto node : nodes) {
-        if constexpr (requires { parentNode->addTopLevelItem(node); })
-            parentNode->addTopLevelItem(node);
-        else
-            parentNode->addChild(node);
-    }
-    // 遍历
-    for (const auto node : nodes) {
-        if (node->isFolder)
-            traverseRead(node->baseDir, node, delNonePdf);
-    }
-}
+        [[nodiscard]] Node* nodeOf (const QModelIndex &index) const;
+        [[nodiscard]] QModelIndex indexOf (Node *node) const;
+        static std::vector<Entry> readFolder (const QString &folder, bool delNonePdf);
+        void scanned (uint64_t scanGeneration, Node *node, std::vector<Entry> entries);
+};
 
 #endif //CHARTNAVIGATION_ENHANCEDTREE_HPP
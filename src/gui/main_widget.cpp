@@ -1,12 +1,8 @@
 #include "main_widget.hpp"
 #include "ui_main_widget.h"
-#include "json.hpp"
 #include "options_widget.hpp"
-#include "enhancedTree.hpp"
 #include "gui/themeColor.hpp"
 
-using namespace nlohmann;
-
 /**
  * @brief 读取和配置设置
  */
@@ -46,7 +42,7 @@ void main_widget::writeSettings () const {
  * @brief 程序启动时初始化文件树和文件夹选择框
  */
 void main_widget::initFileTree () const {
-    ui->treeWidget->clear();
+    treeModel->setRoot({}, true);
     // 文件夹选择框
     const QSettings settings;
     const QString chartText = settings.value("chartFolder", "").toString();
@@ -58,7 +54,9 @@ void main_widget::initFileTree () const {
     }
 }
 
-main_widget::main_widget (QWidget *parent) : QWidget(parent), ui(new Ui::main_widget) {
+main_widget::main_widget (QWidget *parent) : QWidget(parent), ui(new Ui::main_widget),
+                                              pageMappings((QStandardPaths::writableLocation(
+                                                  QStandardPaths::AppLocalDataLocation) + "/fitCache").toStdString()) {
     // 构件初始化
     ui->setupUi(this);
     // PDF文档
@@ -69,11 +67,24 @@ main_widget::main_widget (QWidget *parent) : QWidget(parent), ui(new Ui::main_wi
     // 设置
     readSettings();
     // 构建目录
-    ui->treeWidget->setHeaderHidden(true);
+    treeModel = new ChartTreeModel(this);
+    ui->treeView->setModel(treeModel);
+    ui->treeView->setHeaderHidden(true);
     initFileTree();
+    // 映射索引
+    connect(&mappingWatcher, &QFileSystemWatcher::directoryChanged, this, [this] { mappingIndex.refresh(); });
+    connect(&mappingWatcher, &QFileSystemWatcher::fileChanged, this, [this] { mappingIndex.refresh(); });
+    startMappingIndex();
+    // 回放进度(秒)
+    ui->pdf_widget->setReplayCallback([this](const int64_t timeMs) {
+        const QSignalBlocker blocker(ui->replay_horizontalSlider);
+        ui->replay_horizontalSlider->setValue(static_cast<int>((timeMs - ui->pdf_widget->trackRange().first) / 1000));
+    });
 }
 
 main_widget::~main_widget () {
+    pageMappings.cancel();
+    mappingIndex.stop();
     writeSettings();
     delete ui;
 }
@@ -88,6 +99,9 @@ void main_widget::loadPdfFile (const QString &filePath) {
     ui->pdf_widget->pageNavigator()->jump(0, {0, 0});
     document->close();
     pdfFilePath = "";
+    pageMappings.cancel();
+    loadedChart.reset();
+    mappedPage = -1;
     ui->pdf_widget->loadMappingData({}, 0, 0);
     ui->pageNum_spinBox->setValue(0);
     ui->pageNum_spinBox->setEnabled(false);
@@ -107,74 +121,112 @@ void main_widget::loadPdfFile (const QString &filePath) {
 }
 
 /**
- * @brief 从映射文件中加载仿射变换数据(一个机场文件的数据)
+ * @brief 加载航迹存档并开始回放
+ * @param filePath 文件路径(.trk)
  */
-void main_widget::loadPdfFileMapping () {
-    // 文件夹可用性
+void main_widget::loadTrackFile (const QString &filePath) {
+    auto trackPath = filePath;
+    if (trackPath.startsWith("\"") && trackPath.endsWith("\"") && (trackPath.size() >= 2))
+        trackPath = trackPath.mid(1, trackPath.length() - 2);
+    if (!ui->pdf_widget->loadTrack(trackPath))
+        return;
+    const auto [begin, end] = ui->pdf_widget->trackRange();
+    ui->replay_horizontalSlider->setRange(0, static_cast<int>((end - begin) / 1000));
+    ui->replay_horizontalSlider->setValue(0);
+    ui->replay_horizontalSlider->setVisible(true);
+    ui->replay_pushButton->setVisible(true);
+}
+
+/**
+ * @brief 按设置中的映射文件夹(重新)建立索引,文件夹未变化时不做任何事
+ * @note 扫描在线程池中进行,完成前打开的航图在索引发布后补装
+ */
+void main_widget::startMappingIndex () {
     const QSettings settings;
-    const QString mappingFolder = settings.value("mappingFolder", "").toString();
-    const QDir mappingDir(mappingFolder);
-    if (!mappingDir.exists()) {
-        fileData = {};
+    const QString folder = settings.value("mappingFolder", "").toString();
+    if ((folder == mappingFolder) && mappingIndex.ready())
+        return;
+    mappingFolder = folder;
+    if (!mappingWatcher.directories().isEmpty())
+        mappingWatcher.removePaths(mappingWatcher.directories());
+    if (!mappingWatcher.files().isEmpty())
+        mappingWatcher.removePaths(mappingWatcher.files());
+    mappingIndex.stop();
+    if (!QDir(mappingFolder).exists()) {
+        mappingIndexUpdated();
         return;
     }
-    // 映射文件可用性 ZUCK.Tmap
-    const QString baseName = QFileInfo(pdfFilePath).completeBaseName();
-    const QString icao = baseName.left(4);
-    const QString mappingFilePath = mappingDir.filePath(icao + ".Tmap");
-    QFile mappingFile(mappingFilePath);
-    if (!mappingFile.exists()) {
-        fileData = {};
+    mappingWatcher.addPath(mappingFolder);
+    mappingIndex.start(mappingFolder.toStdWString(), [this] {
+        QMetaObject::invokeMethod(this, [this] { mappingIndexUpdated(); }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief 索引发布新快照: 更新监视的文件,当前航图的映射有变化时重新装载
+ */
+void main_widget::mappingIndexUpdated () {
+    // 保存文件时常以改名替换,监视会丢失,按索引重新设置
+    if (!mappingWatcher.files().isEmpty())
+        mappingWatcher.removePaths(mappingWatcher.files());
+    QStringList files;
+    for (const auto &path : mappingIndex.files())
+        files.append(QString::fromStdWString(path.wstring()));
+    if (!files.isEmpty())
+        mappingWatcher.addPaths(files);
+    if (pdfFilePath.isEmpty())
         return;
+    if (mappingIndex.find(QFileInfo(pdfFilePath).completeBaseName().toStdString()) != loadedChart) {
+        loadPdfFileMapping();
+        applyPageMapping(ui->pageNum_spinBox->value());
     }
+}
+
+/**
+ * @brief 从映射索引中取出当前航图的映射(内存读取,不等待扫描)
+ * @note 全部页面的拟合在线程池中进行,每完成一页发布一次快照
+ */
+void main_widget::loadPdfFileMapping () {
+    pageMappings.cancel();
+    mappedPage = -1;
     // 航图文件可用性 ZUCK-3P-01
-    mappingFile.open(QIODevice::ReadOnly);
-    QTextStream stream(&mappingFile);
-    auto airportConfig = json::parse(stream.readAll().toUtf8().constData());
-    const auto it = airportConfig.find(baseName.toStdString());
-    if (it == airportConfig.end()) {
-        fileData = {};
+    loadedChart = mappingIndex.find(QFileInfo(pdfFilePath).completeBaseName().toStdString());
+    if (!loadedChart)
         return;
-    }
-    fileData = std::move(it.value());
+    pageMappings.start(loadedChart, [this] {
+        QMetaObject::invokeMethod(this, [this] {
+            if (const int page = ui->pageNum_spinBox->value() - 1; page != mappedPage)
+                applyPageMapping(page + 1);
+        }, Qt::QueuedConnection);
+    });
 }
 
 /**
- * @brief 从缓存中加载仿射变换数据(一页的数据)
- * @param pageNum 页码
- * @brief {映射数据,旋转角度,阈值}
+ * @brief 装载一页的映射(只使用后台拟合结果,界面线程不求解)
+ * @param pageNum 页码(起始为1)
+ * @note 该页尚未拟合时先清空映射,拟合完成发布后由回调补装
  */
-main_widget::MappingInfo main_widget::loadPdfPageMapping (const int pageNum) {
-    // 页码可用性
-    const basic_json<> *availableData{nullptr};
-    for (const auto &pageConfig : fileData) {
-        if (const auto &header = pageConfig[0]; header["page"] == pageNum - 1) {
-            availableData = &pageConfig;
-            break;
-        }
-    }
-    if (availableData == nullptr)
-        return {{}, 0, 0};
-    // 装载数据
-    std::vector<std::vector<double>> data;
-    data.reserve(availableData->size() - 1);
-    for (int i = 1; i < availableData->size(); ++i) {
-        const auto &mapData = (*availableData)[i];
-        double d1 = mapData[0];
-        double d2 = mapData[1];
-        double d3 = mapData[2];
-        double d4 = mapData[3];
-        data.push_back({d1, d2, d3, d4});
+void main_widget::applyPageMapping (const int pageNum) {
+    const auto pageMapping = pageMappings.page(pageNum - 1);
+    if ((pageMapping == nullptr) || !pageMapping->fit) {
+        ui->pdf_widget->loadMappingData({}, 0, 0);
+        mappedPage = -1;
+        return;
     }
-    const bool isAirport = (*availableData)[0]["type"] == "parking"; // 机场图10 终端区5
-    return {data, (*availableData)[0]["rotate"], isAirport ? 10.0 : 5.0};
+    ui->pdf_widget->loadMappingFit(pageMapping->data, pageMapping->rotate, pageMapping->threshold,
+                                   *pageMapping->fit, pageMapping->model);
+    mappedPage = pageNum - 1;
 }
 
 /**
  * @brief 文件路径输入框 -> 加载PDF文档
  */
 void main_widget::on_chart_lineEdit_editingFinished () {
-    loadPdfFile(ui->chart_lineEdit->text());
+    const QString text = ui->chart_lineEdit->text();
+    if (text.endsWith(".trk", Qt::CaseInsensitive) || text.endsWith(".trk\"", Qt::CaseInsensitive))
+        loadTrackFile(text);
+    else
+        loadPdfFile(text);
 }
 
 /**
@@ -243,8 +295,7 @@ void main_widget::on_pageNum_spinBox_valueChanged (const int pageNum) {
     const auto pdf = ui->pdf_widget;
     pdf->pageNavigator()->jump(pageNumCorrect - 1, {0, 0}); // 不是很懂这个location
     // 映射数据加载
-    const auto [data, rotate,threshold] = loadPdfPageMapping(pageNumCorrect);
-    ui->pdf_widget->loadMappingData(data, rotate, threshold);
+    applyPageMapping(pageNumCorrect);
 }
 
 /**
@@ -255,18 +306,22 @@ void main_widget::on_license_radioButton_clicked () {
     options->setWindowFlags(Qt::Window);
     options->show();
     options->setAttribute(Qt::WA_DeleteOnClose);
+    // 关闭时设置已写入,映射文件夹变化则重建索引
+    connect(options, &options_widget::settingsSaved, this, &main_widget::startMappingIndex);
 }
 
 /**
  * @brief 双击文件树文件 -> 加载PDF文档
- * @param item 树节点
- * @param column 无用字段
+ * @param index 树节点
  */
-void main_widget::on_treeWidget_itemDoubleClicked (QTreeWidgetItem *item, int column) {
-    const Node *node = dynamic_cast<Node*>(item);
-    if (node->isFolder)
+void main_widget::on_treeView_doubleClicked (const QModelIndex &index) {
+    if (treeModel->isFolder(index))
         return;
-    loadPdfFile(node->baseDir);
+    const QString filePath = treeModel->filePath(index);
+    if (filePath.endsWith(".trk", Qt::CaseInsensitive))
+        loadTrackFile(filePath);
+    else
+        loadPdfFile(filePath);
 }
 
 /**
@@ -275,7 +330,22 @@ void main_widget::on_treeWidget_itemDoubleClicked (QTreeWidgetItem *item, int co
  */
 void main_widget::on_folder_comboBox_currentIndexChanged (const int index) const {
     const QSettings settings;
-    ui->treeWidget->clear();
-    traverseRead(ui->folder_comboBox->itemData(index).toString(), ui->treeWidget,
-                 settings.value("onlyPdf", true).toBool());
+    treeModel->setRoot(ui->folder_comboBox->itemData(index).toString(), settings.value("onlyPdf", true).toBool());
+}
+
+/**
+ * @brief 回放进度拖动
+ * @param position 相对开始的秒数
+ */
+void main_widget::on_replay_horizontalSlider_sliderMoved (const int position) const {
+    ui->pdf_widget->seekTrack(ui->pdf_widget->trackRange().first + static_cast<int64_t>(position) * 1000);
+}
+
+/**
+ * @brief 结束回放
+ */
+void main_widget::on_replay_pushButton_clicked () const {
+    ui->pdf_widget->closeTrack();
+    ui->replay_horizontalSlider->setVisible(false);
+    ui->replay_pushButton->setVisible(false);
 }
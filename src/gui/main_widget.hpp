@@ -1,10 +1,13 @@
 #ifndef CHARTNAVIGATION_MAIN_WIDGET_HPP
 #define CHARTNAVIGATION_MAIN_WIDGET_HPP
 
+#include <QFileSystemWatcher>
 #include <QWidget>
 #include <QtPdf/QtPdf>
 
-#include "json.hpp"
+#include "enhancedTree.hpp"
+#include "utils/mappingIndex.hpp"
+#include "utils/pageMapping.hpp"
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -16,11 +19,6 @@ QT_END_NAMESPACE
 
 class main_widget final : public QWidget {
         Q_OBJECT
-        struct MappingInfo {
-            std::vector<std::vector<double>> mappingData;
-            double rotateAngle;
-            double threshold;
-        };
     public:
         explicit main_widget (QWidget *parent = nullptr);
         ~main_widget () override;
@@ -29,12 +27,21 @@ class main_widget final : public QWidget {
     private:
         Ui::main_widget *ui;
         QPdfDocument *document;
+        ChartTreeModel *treeModel; // 文件树(按需后台读取目录)
         QString pdfFilePath{};
-        nlohmann::json fileData{};
+        MappingIndex mappingIndex; // 映射文件夹索引(后台扫描)
+        QFileSystemWatcher mappingWatcher; // 映射文件变化 -> 索引增量更新
+        QString mappingFolder{}; // 当前索引的文件夹
+        std::shared_ptr<const ChartMapping> loadedChart{}; // 当前航图来自索引的映射,索引更新后据此判断是否重载
+        MappingPrecomputer pageMappings; // 后台拟合
+        int mappedPage{-1}; // 已装载映射的页(起始为0),快照更新时据此补装
 
         void loadPdfFile (const QString &filePath);
+        void loadTrackFile (const QString &filePath);
         void loadPdfFileMapping();
-        MappingInfo loadPdfPageMapping (int pageNum);
+        void startMappingIndex ();
+        void mappingIndexUpdated ();
+        void applyPageMapping (int pageNum);
         void readSettings ();
         void writeSettings () const;
         void initFileTree () const;
@@ -45,8 +52,10 @@ class main_widget final : public QWidget {
         void on_pin_checkBox_clicked (bool checked); // 程序窗口是否置顶
         void on_pageNum_spinBox_valueChanged (int pageNum) ; // PDF文档页数切换
         void on_license_radioButton_clicked (); // 打开设置
-        void on_treeWidget_itemDoubleClicked (QTreeWidgetItem *item, int column); // 文件树选择 -> 加载PDF文档
+        void on_treeView_doubleClicked (const QModelIndex &index); // 文件树选择 -> 加载PDF文档
         void on_folder_comboBox_currentIndexChanged (int index) const; // 更换航图文件夹
+        void on_replay_horizontalSlider_sliderMoved (int position) const; // 回放进度拖动
+        void on_replay_pushButton_clicked () const; // 结束回放
 };
 
 
@@ -1,6 +1,8 @@
 #include "options_widget.hpp"
 #include "ui_options_widget.h"
 
+#include <QCloseEvent>
+
 
 options_widget::options_widget (QWidget *parent) : QWidget(parent), ui(new Ui::options_widget) {
     ui->setupUi(this);
@@ -12,6 +14,15 @@ options_widget::~options_widget () {
     delete ui;
 }
 
+/**
+ * @brief 关闭窗口时写入设置并通知(随父窗口析构时只写入,不通知)
+ */
+void options_widget::closeEvent (QCloseEvent *event) {
+    writeSettings();
+    Q_EMIT settingsSaved();
+    QWidget::closeEvent(event);
+}
+
 void options_widget::readSettings () {
     const QSettings settings;
     // 窗口布局
@@ -28,6 +39,11 @@ void options_widget::readSettings () {
     ui->xpFreq_spinBox->setValue(xpFreq);
     const int centerFreq = settings.value("center_freq", 1).toInt();
     ui->centerFreq_spinBox->setValue(centerFreq);
+    // 连接方式
+    ui->xpTransport_comboBox->setCurrentIndex(settings.value("xp_transport", 0).toInt());
+    ui->xpWebPort_spinBox->setValue(settings.value("xp_web_port", 8086).toInt());
+    // 局域网广播
+    ui->broadcastPort_spinBox->setValue(settings.value("broadcast_port", 0).toInt());
 }
 
 void options_widget::writeSettings () const {
@@ -43,6 +59,11 @@ void options_widget::writeSettings () const {
     // 映射
     settings.setValue("xp_freq", ui->xpFreq_spinBox->value());
     settings.setValue("center_freq", ui->centerFreq_spinBox->value());
+    // 连接方式
+    settings.setValue("xp_transport", ui->xpTransport_comboBox->currentIndex());
+    settings.setValue("xp_web_port", ui->xpWebPort_spinBox->value());
+    // 局域网广播
+    settings.setValue("broadcast_port", ui->broadcastPort_spinBox->value());
 }
 
 void options_widget::on_header_listWidget_currentRowChanged (const int currentRow) const {
@@ -15,6 +15,10 @@ class options_widget final : public QWidget {
     public:
         explicit options_widget (QWidget *parent = nullptr);
         ~options_widget () override;
+    Q_SIGNALS:
+        void settingsSaved (); // 窗口关闭,设置已写入
+    protected:
+        void closeEvent (QCloseEvent *event) override;
     private:
         Ui::options_widget *ui;
 
@@ -1,12 +1,16 @@
 #include "pdfView.hpp"
 #include "tools/stringProcess.hpp"
 #include "tools/constValue.hpp"
+#include "tools/threadPool.hpp"
 
 PdfView::PdfView (QWidget *parent) : QPdfView(parent) {
     setPageMode(PageMode::SinglePage);
     setZoomMode(ZoomMode::Custom);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    // 拟合结果缓存
+    fitCache.setDirectory((QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/fitCache")
+                          .toStdString());
     // 地图绘制
     plane.load(":/map/resources/plane_small.png");
     otherPlane.load(":/map/resources/plane_small_2.png");
@@ -18,6 +22,17 @@ PdfView::PdfView (QWidget *parent) : QPdfView(parent) {
     xpUpdateTimer.setInterval(1000 / centerFreq);
     connect(&xpUpdateTimer, &QTimer::timeout, this, &PdfView::xpInfoUpdate);
     xpUpdateTimer.start();
+    // 控制点编辑
+    refitGuard = std::make_shared<RefitGuard>();
+    refitGuard->view = this;
+    refitTimer.setSingleShot(true);
+    refitTimer.setInterval(500);
+    connect(&refitTimer, &QTimer::timeout, this, &PdfView::refitInBackground);
+}
+
+PdfView::~PdfView () {
+    const std::lock_guard lock(refitGuard->mutex);
+    refitGuard->view = nullptr;
 }
 
 /**
@@ -39,24 +54,210 @@ void PdfView::setCenterOn (const bool center) {
 
 /**
  * @brief 加载仿射变换数据集
- * @param data [[lati,longi,x,y],...]
+ * @param data 控制点
  * @param rotateDegree 机模旋转角度 (显示=实际+rotateDegree)
  * @param threshold 筛选阈值
+ * @param pageModel 映射模型
  */
-void PdfView::loadMappingData (const std::vector<std::vector<double>> &data, const double rotateDegree,
-                               const double threshold) {
+void PdfView::loadMappingData (const std::span<const ControlPoint> data, const double rotateDegree,
+                               const double threshold, const TransformModel pageModel) {
     rotate = rotateDegree;
+    model = pageModel;
+    piecewise.clear();
+    mappingThreshold = threshold;
+    geoToViewValid = false;
+    ++editGeneration;
+    refitTimer.stop();
+    // 缓存命中则跳过求解
+    const uint64_t key = TransformCache::key(data, threshold);
+    if (AffineFit fit; fitCache.load(key, data.size(), fit) && transformer.loadFit(data, fit)) {
+        transActive = true;
+        rebuildPiecewise();
+        qDebug() << std::format("RMS: {:.2f} (cached)", fit.rms);
+        return;
+    }
     transActive = transformer.loadData(data, threshold);
     if (!transActive)
         return;
-    auto [error,errors] = transformer.evaluate();
+    const AffineFit fit = transformer.result();
+    fitCache.store(key, data.size(), fit);
+    rebuildPiecewise();
+#ifndef QT_NO_DEBUG_OUTPUT
     // Debug输出
+    auto [error,errors] = transformer.evaluate();
     auto view = errors | std::views::transform([](double num) { return std::format("{:.2f}", num); });
     qDebug() << std::format("RMS: {:.2f}, errors: [{}]", error, join(view, ", "));
+#endif
+}
+
+/**
+ * @brief 加载已拟合的仿射变换(后台预计算结果)
+ * @param data 控制点
+ * @param rotateDegree 机模旋转角度
+ * @param threshold 筛选阈值
+ * @param fit 拟合结果
+ * @param pageModel 映射模型
+ */
+void PdfView::loadMappingFit (const std::span<const ControlPoint> data, const double rotateDegree,
+                              const double threshold, const AffineFit &fit, const TransformModel pageModel) {
+    rotate = rotateDegree;
+    model = pageModel;
+    mappingThreshold = threshold;
+    geoToViewValid = false;
+    ++editGeneration;
+    refitTimer.stop();
+    transActive = transformer.loadFit(data, fit);
+    rebuildPiecewise();
+    viewport()->update();
+}
+
+/**
+ * @brief 按当前内点重建分片模型(仅 model=piecewise)
+ */
+void PdfView::rebuildPiecewise () {
+    piecewise.clear();
+    if ((model != TransformModel::Piecewise) || !transActive)
+        return;
+    const auto [paramsX, paramsY] = transformer.parameters();
+    piecewise.build(transformer.controlPoints(), transformer.inliers(), paramsX, paramsY);
+}
+
+/**
+ * @brief 增加控制点
+ * @param latitude 纬度
+ * @param longitude 经度
+ * @param x PDF坐标x(点)
+ * @param y PDF坐标y(点)
+ * @return 变换是否可用
+ */
+bool PdfView::addControlPoint (const double latitude, const double longitude, const double x, const double y) {
+    editApplied(transformer.addPoint({latitude, longitude, x, y}));
+    return transActive;
+}
+
+/**
+ * @brief 移动控制点
+ * @param index 控制点索引
+ * @return 变换是否可用
+ */
+bool PdfView::moveControlPoint (const size_t index, const double latitude, const double longitude, const double x,
+                                const double y) {
+    editApplied(transformer.movePoint(index, {latitude, longitude, x, y}));
+    return transActive;
+}
+
+/**
+ * @brief 删除控制点
+ * @param index 控制点索引
+ * @return 变换是否可用
+ */
+bool PdfView::removeControlPoint (const size_t index) {
+    editApplied(transformer.removePoint(index));
+    return transActive;
+}
+
+/**
+ * @brief 编辑后刷新显示,并推迟后台重新拟合
+ */
+void PdfView::editApplied (const bool usable) {
+    transActive = usable;
+    rebuildPiecewise();
+    geoToViewValid = false;
+    ++editGeneration;
+    refitTimer.start();
+    viewport()->update();
+}
+
+/**
+ * @brief 编辑停止后在线程池中对全部控制点重新执行RANSAC,完成时若无新编辑则替换
+ */
+void PdfView::refitInBackground () {
+    const auto current = transformer.controlPoints();
+    std::vector<ControlPoint> points(current.begin(), current.end());
+    boost::asio::post(sharedPool(), [guard = refitGuard, points = std::move(points), threshold = mappingThreshold,
+                          generation = editGeneration] {
+        AffineTransformer solver;
+        RansacOptions options;
+        options.threads = 1;
+        if (!solver.loadData(points, threshold, options))
+            return;
+        AffineFit fit = solver.result();
+        const std::lock_guard lock(guard->mutex);
+        if (guard->view == nullptr)
+            return;
+        QMetaObject::invokeMethod(guard->view, [view = guard->view, points, threshold, generation, fit] {
+            if (generation != view->editGeneration)
+                return;
+            view->transActive = view->transformer.loadFit(points, fit);
+            view->rebuildPiecewise();
+            view->fitCache.store(TransformCache::key(points, threshold), points.size(), fit);
+            view->geoToViewValid = false;
+            view->viewport()->update();
+        }, Qt::QueuedConnection);
+    });
 }
 
 void PdfView::closeXp () {
-    xp.close();
+    std::visit([](auto &client) { client->close(); }, xp);
+    trackWriter.close();
+    if (broadcaster)
+        broadcaster->close();
+}
+
+/**
+ * @brief 加载航迹存档并进入回放状态
+ * @param path 存档路径(.trk)
+ * @return 是否成功
+ */
+bool PdfView::loadTrack (const QString &path) {
+    auto reader = std::make_unique<TrackReader>();
+    if (!reader->open(path.toStdString()))
+        return false;
+    replay = std::move(reader);
+    replayTime = replay->beginTime();
+    replayUpdate();
+    viewport()->update();
+    return true;
+}
+
+/**
+ * @brief 退出回放,恢复实时数据
+ */
+void PdfView::closeTrack () {
+    replay.reset();
+    tcasFrame = {};
+    selfInfoValid = false;
+    viewport()->update();
+}
+
+/**
+ * @brief 回放跳转
+ * @param timeMs 存档时间(毫秒)
+ */
+void PdfView::seekTrack (const int64_t timeMs) {
+    if (!replay)
+        return;
+    replayTime = qBound(replay->beginTime(), timeMs, replay->endTime());
+    replayUpdate();
+    viewport()->update();
+}
+
+/**
+ * @brief 回放时间范围
+ * @return (开始,结束) 毫秒
+ */
+std::pair<int64_t, int64_t> PdfView::trackRange () const {
+    if (!replay)
+        return {0, 0};
+    return {replay->beginTime(), replay->endTime()};
+}
+
+/**
+ * @brief 设置一个回调函数,回放时间推进时会调用
+ * @param callbackFunc 回调函数 接受形参为当前存档时间(毫秒)
+ */
+void PdfView::setReplayCallback (const std::function<void  (int64_t)> &callbackFunc) {
+    replayCallback = callbackFunc;
 }
 
 void PdfView::wheelEvent (QWheelEvent *event) {
@@ -119,7 +320,7 @@ void PdfView::paintEvent (QPaintEvent *event) {
     }
 
     bool check{true};
-    if (!connected) // xp已连接
+    if (!connected && !replay) // xp已连接或回放中
         check = false;
     if (plane.isNull()) // 图片不可用
         check = false;
@@ -127,12 +328,13 @@ void PdfView::paintEvent (QPaintEvent *event) {
         check = false;
     // 飞机绘制逻辑
     if (check) {
+        updateGeoToView();
         painter.setRenderHint(QPainter::Antialiasing);
         painter.setRenderHint(QPainter::SmoothPixmapTransform);
         // 自身
         drawPlane(painter);
         // 其他飞机
-        const size_t count = std::ranges::count_if(multiIdVal, [](const float value) { return value != 0.0f; });
+        const size_t count = std::ranges::count_if(tcasFrame.get<tcas::Id>(), [](const int value) { return value != 0; });
         for (int i = 1; i < count; ++i)
             drawPlane(painter, i);
     }
@@ -141,44 +343,65 @@ void PdfView::paintEvent (QPaintEvent *event) {
 /**
  * @brief 转换经纬度至当前可视范围坐标
  * @return (x,y)
+ * @note 使用缓存的复合矩阵,调用前需 updateGeoToView()
+ */
+std::pair<double, double> PdfView::trans (const double latitude, const double longitude) const {
+    if (!piecewise.empty()) {
+        const auto [x, y] = piecewise.transform(latitude, longitude);
+        const QPointF point = pdfToView.map(QPointF(x, y));
+        return {point.x(), point.y()};
+    }
+    const QPointF point = geoToView.map(QPointF(longitude, latitude));
+    return {point.x(), point.y()};
+}
+
+/**
+ * @brief 视图状态(缩放/滚动/页码/DPI等)变化时重建 经纬度->PDF(点)->视口(像素) 复合矩阵
  */
-std::pair<double, double> PdfView::trans (const double latitude, const double longitude) {
-    // 获取文档位置
-    auto [x, y] = transformer.transform(latitude, longitude);
-    // 获取基本信息
-    const auto viewSize = viewport()->size();
-    const auto *scree = screen();
+void PdfView::updateGeoToView () {
     const auto vertBar = verticalScrollBar(), horzBar = horizontalScrollBar();
-    const auto dpi = scree->logicalDotsPerInch();
-    const auto logicDocSize = zoomFactor() * getDocSize() * dpi / 72;
-    const auto margin = documentMargins();
-    // x计算
-    double finalX{};
-    const double scaleX = x / getDocSize().width(); // 1 PDF (点)
-    double docX = scaleX * logicDocSize.width(); // 2 PDF (像素)
-    if (horzBar->minimum() == horzBar->maximum()) { // 非缩放状态
-        finalX = (viewSize.width() - logicDocSize.width()) / 2 + docX;
-    } else { // 缩放状态
-        docX += margin.left(); // 3 PDF+边缘 (像素)
-        const double barLength = horzBar->maximum() + horzBar->pageStep();
-        const double barLoc = docX / (logicDocSize.width() + margin.left() + margin.right()) * barLength; // 4 滚动条 (像素)
-        const double windowScale = (barLoc - horzBar->value()) / horzBar->pageStep(); // 5 滑动块 (比例)
-        finalX = viewSize.width() * windowScale;
+    const ViewState state{
+        zoomFactor(), screen()->logicalDotsPerInch(), pageNavigator()->currentPage(), viewport()->size(),
+        documentMargins(), horzBar->minimum(), horzBar->maximum(), horzBar->pageStep(), horzBar->value(),
+        vertBar->minimum(), vertBar->maximum(), vertBar->pageStep(), vertBar->value()
+    };
+    if (geoToViewValid && (state == viewState))
+        return;
+    viewState = state;
+    geoToViewValid = true;
+    // 1 经纬度 -> PDF(点)
+    const auto [paramsX, paramsY] = transformer.parameters();
+    const QTransform geo(paramsX(0), paramsY(0), paramsX(1), paramsY(1), paramsX(2), paramsY(2));
+    // 2 PDF(点) -> PDF(像素)
+    const QSizeF docSize = getDocSize(state.page);
+    const double scale = state.zoom * state.dpi / 72;
+    const QSizeF logicDocSize = docSize * scale;
+    const auto &margin = state.margins;
+    const double viewW = state.viewport.width(), viewH = state.viewport.height();
+    // 3 PDF(像素) -> 视口(像素) 每个方向都是 a*t+b
+    double ax, bx, ay, by;
+    if (state.hMin == state.hMax) { // 非缩放状态
+        ax = scale;
+        bx = (viewW - logicDocSize.width()) / 2;
+    } else { // 缩放状态: 经滚动条比例换算
+        const double barLength = state.hMax + state.hPage;
+        const double total = logicDocSize.width() + margin.left() + margin.right();
+        const double k = viewW * barLength / (total * state.hPage);
+        ax = k * scale;
+        bx = k * margin.left() - viewW * state.hValue / state.hPage;
     }
-    // y计算
-    double finalY{};
-    const double scaleY = y / getDocSize().width();
-    double docY = scaleY * logicDocSize.width();
-    if (vertBar->minimum() == vertBar->maximum()) { // 非缩放状态
-        finalY = margin.top() + docY;
+    if (state.vMin == state.vMax) { // 非缩放状态
+        ay = scale;
+        by = margin.top();
     } else { // 缩放状态
-        docY += margin.top(); // 3 PDF+边缘 (像素)
-        const double barLength = vertBar->maximum() + vertBar->pageStep();
-        const double barLoc = docY / (logicDocSize.height() + margin.top() + margin.bottom()) * barLength; // 4 滚动条 (像素)
-        const double windowScale = (barLoc - vertBar->value()) / vertBar->pageStep(); // 5 滑动块 (比例)
-        finalY = viewSize.height() * windowScale;
+        const double barLength = state.vMax + state.vPage;
+        const double total = logicDocSize.height() + margin.top() + margin.bottom();
+        const double k = viewH * barLength / (total * state.vPage);
+        ay = k * scale;
+        by = k * margin.top() - viewH * state.vValue / state.vPage;
     }
-    return {finalX, finalY};
+    pdfToView = QTransform(ax, 0, 0, ay, bx, by);
+    geoToView = geo * pdfToView;
 }
 
 /**
@@ -190,8 +413,8 @@ void PdfView::drawPlane (QPainter &painter, const int idx) {
     const bool isSelf = (idx == 0);
     painter.save();
     // 变量声明
-    const double latitude{multiLatVal[idx]}, longitude{multiLonVal[idx]}, vs{multiVsVal[idx]}, alt{multiAltVal[idx]};
-    double trk{multiTrkVal[idx]};
+    const auto [latitude, longitude, alt, track, vs] = planeState(idx);
+    double trk{track};
     // 移动坐标系
     auto [x,y] = trans(latitude, longitude);
     painter.translate(x, y);
@@ -213,11 +436,12 @@ void PdfView::drawPlane (QPainter &painter, const int idx) {
         // 航班信息
         QString flightId;
         flightId.reserve(7);
+        const auto &flightIds = tcasFrame.get<tcas::FlightId>();
         for (int i = 8 * idx; i < 8 * (idx + 1) - 1; ++i)
-            if (multiFlightIdVal[i] != 0)
-                flightId.append(QChar(static_cast<char>(multiFlightIdVal[i])));
+            if (flightIds[i] != 0)
+                flightId.append(QChar(flightIds[i]));
         // 高度信息
-        int deltaAlt = static_cast<int>(std::round((alt - multiAltVal[0]) * m2ft / 100));
+        int deltaAlt = static_cast<int>(std::round((alt - planeState(0).alt) * m2ft / 100));
         QString delta;
         if (deltaAlt >= 0)
             delta = QString::fromStdString(std::format("{:02d}", deltaAlt));
@@ -243,6 +467,21 @@ void PdfView::drawPlane (QPainter &painter, const int idx) {
     painter.restore();
 }
 
+/**
+ * @brief 获取飞机状态
+ * @param idx 飞机索引(0为自身)
+ * @return 状态
+ * @note 自身优先使用RPOS(双精度),不可用时回退至TCAS数组0号位
+ */
+PdfView::PlaneState PdfView::planeState (const int idx) const {
+    if ((idx == 0) && selfInfoValid)
+        return {selfInfo.lat, selfInfo.lon, selfInfo.alt, selfInfo.track, selfInfo.vY * m2ft * 60};
+    return {
+        tcasFrame.get<tcas::Lat>()[idx], tcasFrame.get<tcas::Lon>()[idx], tcasFrame.get<tcas::Alt>()[idx],
+        tcasFrame.get<tcas::Trk>()[idx], tcasFrame.get<tcas::Vs>()[idx]
+    };
+}
+
 /**
  * @brief 设置色彩主题
  * @param darkTheme 是否使用暗色主题
@@ -255,23 +494,31 @@ void PdfView::setColorTheme (const bool darkTheme) {
  * @brief 更新机模的基本信息
  */
 void PdfView::xpInfoUpdate () {
-    if (!connected || !transActive) {
+    if (replay) {
+        replayTime = std::min(replayTime + xpUpdateTimer.interval(), replay->endTime());
+        replayUpdate();
+        if (replayCallback)
+            replayCallback(replayTime);
+    } else if (connected) {
+        std::visit([this](auto &client) {
+            client->template getSchema<tcas::Schema>(tcasIdx, tcasFrame);
+            if constexpr (requires { client->getPlaneInfo(selfInfo); })
+                selfInfoValid = client->getPlaneInfo(selfInfo); // 未收到或已停止的RPOS改用TCAS位置
+        }, xp);
+        recordTrack();
+    }
+    if ((!connected && !replay) || !transActive) {
         viewport()->update();
         return;
     }
-    xp.getDataref(multiId, multiIdVal);
-    xp.getDataref(multiLat, multiLatVal);
-    xp.getDataref(multiLon, multiLonVal);
-    xp.getDataref(multiAlt, multiAltVal);
-    xp.getDataref(multiTrk, multiTrkVal);
-    xp.getDataref(multiVs, multiVsVal);
-    xp.getDataref(multiFlightId, multiFlightIdVal);
     if (!centerOn || dragging) {
         viewport()->update();
         return;
     }
 
-    auto [x,y] = trans(multiLatVal[0], multiLonVal[0]);
+    const auto self = planeState(0);
+    updateGeoToView();
+    auto [x,y] = trans(self.latitude, self.longitude);
     constexpr double edge{10};
     if ((x < -edge) || (x > viewport()->width() + edge))
         return;
@@ -293,23 +540,92 @@ void PdfView::xpInfoUpdate () {
     viewport()->update();
 }
 
+/**
+ * @brief 记录当前帧至航迹存档,并广播给局域网客户端
+ */
+void PdfView::recordTrack () {
+    if (!trackWriter.isOpen() && !broadcaster)
+        return;
+    const auto &ids = tcasFrame.get<tcas::Id>();
+    trackPoints.clear();
+    for (int i = 0; i < static_cast<int>(ids.size()); ++i) {
+        if ((i != 0) && (ids[i] == 0))
+            continue;
+        const auto [latitude, longitude, alt, trk, vs] = planeState(i);
+        if ((latitude == 0) && (longitude == 0))
+            continue;
+        trackPoints.emplace_back(static_cast<uint32_t>(i), latitude, longitude, alt, trk);
+    }
+    trackWriter.append(QDateTime::currentMSecsSinceEpoch(), trackPoints);
+    if (broadcaster)
+        broadcaster->publish(trackPoints);
+}
+
+/**
+ * @brief 从存档中取出回放时刻的状态,写入TCAS帧与自身信息
+ */
+void PdfView::replayUpdate () {
+    int64_t frameTime{};
+    tcasFrame = {};
+    selfInfoValid = false;
+    if (!replay->stateAt(replayTime, frameTime, trackPoints))
+        return;
+    for (const auto &[id, latitude, longitude, alt, track] : trackPoints) {
+        if (id >= tcas::Id::length)
+            continue;
+        tcasFrame.get<tcas::Id>()[id] = 1; // 仅标记存在
+        tcasFrame.get<tcas::Lat>()[id] = static_cast<float>(latitude);
+        tcasFrame.get<tcas::Lon>()[id] = static_cast<float>(longitude);
+        tcasFrame.get<tcas::Alt>()[id] = static_cast<float>(alt);
+        tcasFrame.get<tcas::Trk>()[id] = static_cast<float>(track);
+        if (id == 0) {
+            selfInfo.lat = latitude;
+            selfInfo.lon = longitude;
+            selfInfo.alt = alt;
+            selfInfo.track = static_cast<float>(track);
+            selfInfo.vY = 0;
+            selfInfoValid = true;
+        }
+    }
+}
+
 /**
  * @brief 初始化xp的一些东西
  */
 void PdfView::xpInit () {
     const QSettings settings;
     const int xpFreq = settings.value("xp_freq", 1).toInt();
-    // AI或多人
-    multiId = xp.addDatarefArray("sim/cockpit2/tcas/targets/modeS_id", 64, xpFreq);
-    multiLat = xp.addDatarefArray("sim/cockpit2/tcas/targets/position/lat", 64, xpFreq);
-    multiLon = xp.addDatarefArray("sim/cockpit2/tcas/targets/position/lon", 64, xpFreq);
-    multiAlt = xp.addDatarefArray("sim/cockpit2/tcas/targets/position/ele", 64, xpFreq);
-    multiTrk = xp.addDatarefArray("sim/cockpit2/tcas/targets/position/psi", 64, xpFreq);
-    multiVs = xp.addDatarefArray("sim/cockpit2/tcas/targets/position/vertical_speed", 64, xpFreq);
-    multiFlightId = xp.addDatarefArray("sim/cockpit2/tcas/targets/flight_id", 512, xpFreq);
-    // 回调
-    xp.setCallback([this](const bool state) {
-        this->connected = state;
-        qDebug() << "XPlane change state: " << state;
-    });
+    // 连接方式 0:UDP 1:Web API(XPlane 12)
+    if (settings.value("xp_transport", 0).toInt() == 1) {
+        const auto port = static_cast<unsigned short>(settings.value("xp_web_port", eyderoe::WEB_API_PORT).toInt());
+        xp = std::make_unique<eyderoe::XPlaneWeb>("127.0.0.1", port);
+    } else
+        xp = std::make_unique<eyderoe::XPlaneUdp>();
+    // 航迹存档 每次启动一个文件
+    if (settings.value("record_track", true).toBool()) {
+        const QDir trackDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/tracks");
+        if (trackDir.mkpath("."))
+            trackWriter.open(trackDir.filePath(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".trk")
+                             .toStdString());
+    }
+    // 局域网广播 端口为0时不启用
+    if (const int port = settings.value("broadcast_port", 0).toInt(); port > 0) {
+        try {
+            broadcaster = std::make_unique<StateBroadcaster>(static_cast<unsigned short>(port));
+        } catch (const boost::system::system_error &e) {
+            qDebug() << "broadcast disabled: " << e.what();
+        }
+    }
+    std::visit([this, xpFreq](auto &client) {
+        // AI或多人
+        tcasIdx = client->template addSchema<tcas::Schema>(xpFreq);
+        // 自身 RPOS 一个包包含全部信息
+        if constexpr (requires { client->addPlaneInfo(xpFreq); })
+            client->addPlaneInfo(xpFreq);
+        // 回调
+        client->setCallback([this](const bool state) {
+            this->connected = state;
+            qDebug() << "XPlane change state: " << state;
+        });
+    }, xp);
 }
@@ -2,18 +2,65 @@
 #define CHARTNAVIGATION_PDFVIEW_HPP
 
 #include <QtPdfWidgets/QPdfView>
+#include <mutex>
 #include "XPlaneUDP.hpp"
+#include "XPlaneWeb.hpp"
+#include "XPlaneSchema.hpp"
 #include "utils/affineTransformer.hpp"
+#include "utils/piecewiseAffine.hpp"
+#include "utils/transformCache.hpp"
+#include "utils/trackArchive.hpp"
+#include "utils/stateBroadcaster.hpp"
+
+// TCAS 目标(AI或多人),0号位为自身
+namespace tcas
+{
+using Id = eyderoe::Dataref<"sim/cockpit2/tcas/targets/modeS_id", 64, int>;
+using Lat = eyderoe::Dataref<"sim/cockpit2/tcas/targets/position/lat", 64>;
+using Lon = eyderoe::Dataref<"sim/cockpit2/tcas/targets/position/lon", 64>;
+using Alt = eyderoe::Dataref<"sim/cockpit2/tcas/targets/position/ele", 64>;
+using Trk = eyderoe::Dataref<"sim/cockpit2/tcas/targets/position/psi", 64>;
+using Vs = eyderoe::Dataref<"sim/cockpit2/tcas/targets/position/vertical_speed", 64>;
+using FlightId = eyderoe::Dataref<"sim/cockpit2/tcas/targets/flight_id", 512, char>;
+using Schema = eyderoe::DatarefSchema<Id, Lat, Lon, Alt, Trk, Vs, FlightId>;
+}
 
 // https://doc-snapshots.qt.io/qt6-6.9/qtpdf-index.html
 class PdfView final : public QPdfView {
+        struct PlaneState {
+            double latitude, longitude, alt; // 纬度 经度 高度(米)
+            double trk, vs; // 航向 垂直速度(英尺/分)
+        };
+        struct ViewState {
+            double zoom, dpi;
+            int page;
+            QSize viewport;
+            QMargins margins;
+            int hMin, hMax, hPage, hValue; // 水平滚动条
+            int vMin, vMax, vPage, vValue; // 垂直滚动条
+            bool operator== (const ViewState &) const = default;
+        };
     public:
         explicit PdfView (QWidget *parent = nullptr);
+        ~PdfView () override;
         QSizeF getDocSize (int page = 0) const;
         void setCenterOn (bool center);
         void setColorTheme (bool darkTheme);
-        void loadMappingData (const std::vector<std::vector<double>> &data, double rotateDegree, double threshold);
+        void loadMappingData (std::span<const ControlPoint> data, double rotateDegree, double threshold,
+                              TransformModel model = TransformModel::Affine);
+        void loadMappingFit (std::span<const ControlPoint> data, double rotateDegree, double threshold,
+                             const AffineFit &fit, TransformModel model = TransformModel::Affine);
+        // 控制点编辑(参数立即更新,停止编辑后后台重新筛选异常值)
+        bool addControlPoint (double latitude, double longitude, double x, double y);
+        bool moveControlPoint (size_t index, double latitude, double longitude, double x, double y);
+        bool removeControlPoint (size_t index);
         void closeXp();
+        // 航迹回放
+        bool loadTrack (const QString &path);
+        void closeTrack ();
+        void seekTrack (int64_t timeMs);
+        std::pair<int64_t, int64_t> trackRange () const;
+        void setReplayCallback (const std::function<void  (int64_t)> &callbackFunc);
     private:
         // 重载事件部分
         void wheelEvent (QWheelEvent *event) override;
@@ -22,10 +69,17 @@ class PdfView final : public QPdfView {
         void mouseReleaseEvent (QMouseEvent *event) override;
         void paintEvent (QPaintEvent *event) override;
         // x-plane部分
-        std::pair<double, double> trans (double latitude, double longitude);
+        std::pair<double, double> trans (double latitude, double longitude) const;
+        void updateGeoToView ();
+        void rebuildPiecewise ();
         void drawPlane (QPainter &painter,int idx = 0);
+        PlaneState planeState (int idx) const;
         void xpInfoUpdate ();
         void xpInit ();
+        void recordTrack ();
+        void editApplied (bool usable);
+        void refitInBackground ();
+        void replayUpdate ();
 
         // 地图拖动逻辑
         bool dragging{};
@@ -36,15 +90,37 @@ class PdfView final : public QPdfView {
         double rotate{};
         // 仿射变换
         AffineTransformer transformer{};
+        TransformCache fitCache{};
+        PiecewiseAffine piecewise{}; // 分片模型(仅 model=piecewise 的页面非空)
+        TransformModel model{TransformModel::Affine};
+        QTransform geoToView{}; // 经纬度 -> 视口(像素) 复合矩阵
+        QTransform pdfToView{}; // PDF(点) -> 视口(像素),分片模型使用
+        ViewState viewState{}; // 构建 geoToView 时的视图状态
+        bool geoToViewValid{false};
         bool transActive{false};
+        double mappingThreshold{}; // 当前页筛选阈值
+        QTimer refitTimer; // 编辑停止后触发后台RANSAC
+        uint64_t editGeneration{0}; // 映射或编辑变化时递增,过期的后台结果被丢弃
+        struct RefitGuard {
+            std::mutex mutex;
+            PdfView *view;
+        };
+        std::shared_ptr<RefitGuard> refitGuard; // 析构后后台任务不再回调
         // x-plane
         QPixmap plane, otherPlane;
-        eyderoe::XPlaneUdp xp;
-        eyderoe::XPlaneUdp::DatarefIndex multiId{}, multiLat{}, multiLon{}, multiAlt{}, multiTrk{}, multiVs{},
-                                         multiFlightId{};
-        std::array<float, 64> multiIdVal{}, multiLatVal{}, multiLonVal{}, multiAltVal{}, multiTrkVal{}, multiVsVal{};
-        std::array<float, 512> multiFlightIdVal{};
+        std::variant<std::unique_ptr<eyderoe::XPlaneUdp>, std::unique_ptr<eyderoe::XPlaneWeb>> xp; // UDP / Web API
+        eyderoe::XPlaneUdp::DatarefIndex tcasIdx{};
+        tcas::Schema::Frame tcasFrame{};
+        eyderoe::XPlaneUdp::PlaneInfo selfInfo{}; // RPOS 自身信息(双精度)
+        bool selfInfoValid{false};
         bool connected{false};
+        // 航迹存档
+        TrackWriter trackWriter;
+        std::unique_ptr<TrackReader> replay; // 非空时处于回放状态
+        int64_t replayTime{};
+        std::vector<TrackPoint> trackPoints;
+        std::function<void  (int64_t)> replayCallback{nullptr};
+        std::unique_ptr<StateBroadcaster> broadcaster; // 局域网广播,未启用时为空
         // 定时器
         QTimer xpUpdateTimer;
 };
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <string>
+
+#include "utils/affineTransformer.hpp"
+#include "utils/pageMapping.hpp"
+#include "utils/simdKernel.hpp"
+#include "tools/hash.hpp"
+
+/**
+ * 映射求解的回归与性能测试 (无界面)
+ * 用法: MappingBench [映射文件夹=example] [种子=1] [每页合成数=8] [离群比例=0.25] [算法=auto|ransac|irls]
+ * 对每个 .Tmap 的每一页:原始控制点求解一次,再生成若干合成变体(在原拟合上取点、加噪声、注入离群点)
+ * 输出制表符分隔: 航图 页 变体 点数 注入 检出 召回率 误报 RMS 耗时(微秒)
+ * 任一页未达到下列门限时在标准错误输出 REGRESSION 行,并以 1 退出
+ */
+
+namespace
+{
+constexpr int SYNTHETIC_POINTS{60}; // 合成变体点数
+constexpr double NOISE{0.5}; // 内点噪声(点)
+// 回归门限
+constexpr double MIN_RECALL{0.95}; // 合成变体: 注入离群点的最低检出率
+constexpr size_t MAX_FALSE_ALARM{0}; // 合成变体: 内点被误判为离群的上限(离群偏移至少为阈值的3倍)
+constexpr double MAX_SYNTHETIC_RMS{3 * NOISE}; // 合成变体: 内点RMS上限
+constexpr double MAX_ORIGINAL_RMS_RATIO{0.5}; // 原始页面: RMS不超过筛选阈值的比例
+
+struct Result {
+    size_t points, injected, detected, hit, falseAlarm;
+    double rms, micros;
+};
+
+/**
+ * @brief 求解并统计
+ * @param data 控制点
+ * @param outliers 注入的离群点标记(可为空)
+ */
+Result run (const std::vector<ControlPoint> &data, const double threshold, const std::vector<bool> &outliers,
+            const uint64_t seed, const RobustEngine engine) {
+    AffineTransformer transformer;
+    RansacOptions options;
+    options.seed = seed;
+    options.engine = engine;
+    options.threads = 1;
+    const auto begin = std::chrono::steady_clock::now();
+    const bool ok = transformer.loadData(data, threshold, options);
+    const auto end = std::chrono::steady_clock::now();
+    Result result{data.size(), 0, 0, 0, 0, std::nan(""), std::chrono::duration<double, std::micro>(end - begin).count()};
+    if (!ok)
+        return result;
+    const AffineFit fit = transformer.result();
+    result.rms = fit.rms;
+    for (size_t i = 0; i < data.size(); ++i) {
+        const bool injected = !outliers.empty() && outliers[i];
+        const bool detected = !testBit(fit.inlierMask, i);
+        result.injected += injected;
+        result.detected += detected;
+        result.hit += injected && detected;
+        result.falseAlarm += !injected && detected;
+    }
+    return result;
+}
+
+/**
+ * @brief 在原拟合上生成合成变体
+ * @param fit 原始页面(已求解)的变换
+ * @param data 原始控制点(确定经纬度范围)
+ */
+std::vector<ControlPoint> synthesize (AffineTransformer &fit, const std::vector<ControlPoint> &data,
+                                      const double threshold, const double outlierRatio, std::mt19937_64 &rng,
+                                      std::vector<bool> &outliers) {
+    double latMin{90}, latMax{-90}, lonMin{180}, lonMax{-180};
+    for (const auto &point : data) {
+        latMin = std::min(latMin, point.latitude);
+        latMax = std::max(latMax, point.latitude);
+        lonMin = std::min(lonMin, point.longitude);
+        lonMax = std::max(lonMax, point.longitude);
+    }
+    std::uniform_real_distribution<double> lat(latMin, latMax), lon(lonMin, lonMax), unit(0, 1);
+    std::normal_distribution<double> noise(0, NOISE);
+    std::vector<ControlPoint> result;
+    outliers.assign(SYNTHETIC_POINTS, false);
+    for (int i = 0; i < SYNTHETIC_POINTS; ++i) {
+        const double la = lat(rng), lo = lon(rng);
+        auto [x, y] = fit.transform(la, lo);
+        x += noise(rng);
+        y += noise(rng);
+        if (unit(rng) < outlierRatio) { // 离群:偏移阈值的3~30倍
+            const double angle = unit(rng) * 2 * std::numbers::pi;
+            const double distance = threshold * (3 + 27 * unit(rng));
+            x += distance * std::cos(angle);
+            y += distance * std::sin(angle);
+            outliers[i] = true;
+        }
+        result.push_back({la, lo, x, y});
+    }
+    return result;
+}
+
+double recallOf (const Result &r) {
+    return r.injected ? static_cast<double>(r.hit) / static_cast<double>(r.injected) : 1.0;
+}
+
+/**
+ * @brief 检查一次求解是否达到回归门限
+ * @param threshold 页面筛选阈值
+ * @param synthetic 是否为合成变体
+ * @return 未达到的原因(达到时为空)
+ */
+std::string regression (const Result &r, const double threshold, const bool synthetic) {
+    if (std::isnan(r.rms))
+        return "not solved";
+    if (!synthetic) {
+        if (r.rms > threshold * MAX_ORIGINAL_RMS_RATIO)
+            return std::format("rms {:.3f} > {:.3f}", r.rms, threshold * MAX_ORIGINAL_RMS_RATIO);
+        if (r.detected * 2 > r.points)
+            return std::format("{} of {} points rejected", r.detected, r.points);
+        return {};
+    }
+    if (recallOf(r) < MIN_RECALL)
+        return std::format("recall {:.3f} < {:.3f}", recallOf(r), MIN_RECALL);
+    if (r.falseAlarm > MAX_FALSE_ALARM)
+        return std::format("{} false alarms > {}", r.falseAlarm, MAX_FALSE_ALARM);
+    if (r.rms > MAX_SYNTHETIC_RMS)
+        return std::format("rms {:.3f} > {:.3f}", r.rms, MAX_SYNTHETIC_RMS);
+    return {};
+}
+
+void print (const std::string &chart, const int page, const std::string &variant, const Result &r) {
+    const double recall = recallOf(r);
+    std::cout << std::format("{}\t{}\t{}\t{}\t{}\t{}\t{:.3f}\t{}\t{:.3f}\t{:.1f}\n", chart, page, variant, r.points,
+                             r.injected, r.detected, recall, r.falseAlarm, r.rms, r.micros);
+}
+}
+
+
+int main (const int argc, char *argv[]) {
+    const std::filesystem::path folder = argc > 1 ? argv[1] : "example";
+    const uint64_t seed = argc > 2 ? std::stoull(argv[2]) : 1;
+    const int variants = argc > 3 ? std::stoi(argv[3]) : 8;
+    const double outlierRatio = argc > 4 ? std::stod(argv[4]) : 0.25;
+    const std::string engineName = argc > 5 ? argv[5] : "auto";
+    const RobustEngine engine = engineName == "ransac" ? RobustEngine::Ransac
+                                : engineName == "irls" ? RobustEngine::Irls
+                                : RobustEngine::Auto;
+    // 文件名排序,保证输出顺序固定
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::directory_iterator(folder))
+        if (entry.path().extension() == ".Tmap")
+            files.push_back(entry.path());
+    std::ranges::sort(files);
+    std::cout << "chart\tpage\tvariant\tpoints\tinjected\tdetected\trecall\tfalse\trms\tmicros\n";
+    double totalRecall{0}, totalMicros{0};
+    size_t synthetic{0}, pages{0}, regressions{0};
+    const auto check = [&] (const std::string &chart, const int page, const std::string &variant, const Result &r,
+                            const double threshold) {
+        const auto reason = regression(r, threshold, variant != "original");
+        if (reason.empty())
+            return;
+        std::cerr << std::format("REGRESSION\t{}\t{}\t{}\t{}\n", chart, page, variant, reason);
+        ++regressions;
+    };
+    for (const auto &file : files) {
+        for (const auto &[chart, mapping] : readTmap(file)) {
+            for (const auto &pageMapping : mapping) {
+                if (!pageMapping)
+                    continue;
+                const uint64_t pageSeed = chartPageSeed(seed, chart, pageMapping->page);
+                ++pages;
+                const Result original = run(pageMapping->data, pageMapping->threshold, {}, pageSeed, engine);
+                print(chart, pageMapping->page, "original", original);
+                check(chart, pageMapping->page, "original", original, pageMapping->threshold);
+                totalMicros += original.micros;
+                AffineTransformer clean;
+                RansacOptions options;
+                options.seed = pageSeed;
+                if (!clean.loadData(pageMapping->data, pageMapping->threshold, options))
+                    continue;
+                std::mt19937_64 rng(pageSeed);
+                for (int v = 0; v < variants; ++v) {
+                    std::vector<bool> outliers;
+                    const auto data = synthesize(clean, pageMapping->data, pageMapping->threshold, outlierRatio, rng,
+                                                 outliers);
+                    const Result r = run(data, pageMapping->threshold, outliers, pageSeed + v + 1, engine);
+                    const auto variant = std::format("synthetic{}", v);
+                    print(chart, pageMapping->page, variant, r);
+                    check(chart, pageMapping->page, variant, r, pageMapping->threshold);
+                    totalRecall += recallOf(r);
+                    totalMicros += r.micros;
+                    ++synthetic;
+                }
+            }
+        }
+    }
+    std::cerr << std::format("pages: {}, synthetic: {}, mean recall: {:.3f}, total: {:.1f} us, regressions: {}\n",
+                             pages, synthetic, synthetic ? totalRecall / static_cast<double>(synthetic) : 1.0,
+                             totalMicros, regressions);
+    return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#include <QCoreApplication>
+#include <QPdfDocument>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "json.hpp"
+#include "utils/affineTransformer.hpp"
+#include "utils/controlPointExtractor.hpp"
+#include "utils/pageMapping.hpp"
+#include "utils/simdKernel.hpp"
+#include "utils/tbinFile.hpp"
+#include "tools/hash.hpp"
+#include "tools/threadPool.hpp"
+
+/**
+ * 批量生成与校验映射文件 (无界面,不依赖 Qt Widgets)
+ * 用法: TmapBuilder [航图文件夹=.] [映射文件夹=航图文件夹] [种子=1] [模式=check|build|compile|extract]
+ * 递归查找 PDF,已有映射的页面直接求解,没有映射的页面从文字层识别控制点后求解
+ * build 模式将识别出的页面(仅内点)追加到 ICAO.Tmap,已有页面不改动
+ * compile 模式在最后把映射文件夹中的每个 .Tmap 编译为同名 .Tbin
+ * 输出制表符分隔: 航图 页 来源 点数 离群 RMS;同一种子的输出逐字节一致
+ * extract 模式只识别不求解: 逐份航图、页面并行,输出全部候选点 航图 页 纬度 经度 x y 标识
+ */
+
+using namespace nlohmann;
+
+namespace
+{
+constexpr double EXTRACTED_THRESHOLD{5.0}; // 识别页面按终端区阈值筛选
+constexpr size_t MIN_POINTS{3};
+constexpr std::string_view USAGE{
+    "usage: TmapBuilder [chartFolder=.] [mappingFolder=chartFolder] [seed=1] [mode=check|build|compile|extract]\n"
+};
+
+struct PageReport {
+    int page;
+    std::string source; // tmap / text / none
+    size_t points, outliers;
+    double rms;
+    std::vector<ControlPointCandidate> inliers; // 识别页面的内点(写入映射文件)
+};
+
+struct ChartReport {
+    std::filesystem::path pdf;
+    std::string chart, icao;
+    bool readable{false};
+    std::vector<PageReport> pages;
+};
+
+/**
+ * @brief 求解一页并统计
+ * @return 是否求解成功
+ */
+bool fitPage (const std::span<const ControlPoint> data, const double threshold, const uint64_t seed,
+              PageReport &report, std::vector<uint64_t> &mask) {
+    report.points = data.size();
+    AffineTransformer transformer;
+    RansacOptions options;
+    options.seed = seed;
+    options.threads = 1; // 航图之间已经并行
+    if ((data.size() < MIN_POINTS) || !transformer.loadData(data, threshold, options))
+        return false;
+    const AffineFit fit = transformer.result();
+    mask = fit.inlierMask;
+    report.rms = fit.rms;
+    for (size_t i = 0; i < data.size(); ++i)
+        report.outliers += !testBit(mask, i);
+    return true;
+}
+
+/**
+ * @brief 处理一份航图
+ * @param mappingFolder 映射文件夹
+ * @param seed 全局种子
+ */
+ChartReport processChart (const std::filesystem::path &pdf, const std::filesystem::path &mappingFolder,
+                          const uint64_t seed) {
+    ChartReport report{pdf, pdf.stem().string(), pdf.stem().string().substr(0, 4)};
+    QPdfDocument document;
+    if (document.load(QString::fromStdWString(pdf.wstring())) != QPdfDocument::Error::None)
+        return report;
+    report.readable = true;
+    // 已有映射(按页码索引)
+    const ChartMapping existing = readTmapChart(mappingFolder / (report.icao + ".Tmap"), report.chart).value_or(
+        ChartMapping{});
+    for (int page = 0; page < document.pageCount(); ++page) {
+        PageReport pageReport{page, "none", 0, 0, std::nan("")};
+        const uint64_t pageSeed = chartPageSeed(seed, report.chart, page);
+        std::vector<uint64_t> mask;
+        if (const auto pageMapping = findPage(existing, page)) {
+            if (fitPage(pageMapping->data, pageMapping->threshold, pageSeed, pageReport, mask))
+                pageReport.source = "tmap";
+        } else {
+            const auto candidates = extractPageControlPoints(document, page);
+            std::vector<ControlPoint> data;
+            data.reserve(candidates.size());
+            for (const auto &candidate : candidates)
+                data.push_back({candidate.latitude, candidate.longitude, candidate.x, candidate.y});
+            if (fitPage(data, EXTRACTED_THRESHOLD, pageSeed, pageReport, mask)) {
+                pageReport.source = "text";
+                for (size_t i = 0; i < candidates.size(); ++i)
+                    if (testBit(mask, i))
+                        pageReport.inliers.push_back(candidates[i]);
+            }
+        }
+        report.pages.push_back(std::move(pageReport));
+    }
+    return report;
+}
+
+/**
+ * @brief 将识别出的页面追加到映射文件(保持原有内容与顺序)
+ * @return 追加的页数
+ */
+size_t writeTmap (const std::filesystem::path &tmapPath, const std::vector<const ChartReport *> &reports) {
+    ordered_json airport = ordered_json::object();
+    if (std::ifstream file(tmapPath, std::ios::binary); file.is_open()) {
+        try {
+            airport = ordered_json::parse(file);
+        } catch (const json::exception &) {
+            return 0; // 不覆盖无法解析的文件
+        }
+    }
+    size_t added{0};
+    for (const auto *report : reports) {
+        for (const auto &page : report->pages) {
+            if (page.source != "text")
+                continue;
+            ordered_json pageConfig = ordered_json::array();
+            pageConfig.push_back({{"page", page.page}, {"type", "terminal"}, {"rotate", 0},
+                                  {"remark", "lati, longi, x, y, ident"}});
+            for (const auto &point : page.inliers)
+                pageConfig.push_back({point.latitude, point.longitude, point.x, point.y, point.ident.toStdString()});
+            airport[report->chart].push_back(std::move(pageConfig));
+            ++added;
+        }
+    }
+    if (added == 0)
+        return 0;
+    // 先写临时文件再替换,中断时不留半个文件
+    const std::filesystem::path temp = tmapPath.string() + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return 0;
+        file << airport.dump(2);
+        if (!file.good())
+            return 0;
+    }
+    std::error_code error;
+    std::filesystem::rename(temp, tmapPath, error);
+    return error ? 0 : added;
+}
+}
+
+
+int main (int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    if (argc > 5) {
+        std::cerr << USAGE;
+        return 2;
+    }
+    const std::filesystem::path chartFolder = argc > 1 ? argv[1] : ".";
+    const std::filesystem::path mappingFolder = argc > 2 ? argv[2] : chartFolder;
+    uint64_t seed{1};
+    if (argc > 3) {
+        const std::string_view text(argv[3]);
+        if (const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), seed);
+            (ec != std::errc{}) || (ptr != text.data() + text.size())) {
+            std::cerr << std::format("invalid seed: {}\n", text) << USAGE;
+            return 2;
+        }
+    }
+    const std::string mode = argc > 4 ? argv[4] : "check";
+    if ((mode != "check") && (mode != "build") && (mode != "compile") && (mode != "extract")) {
+        std::cerr << std::format("unknown mode: {}\n", mode) << USAGE;
+        return 2;
+    }
+    const bool build = (mode == "build") || (mode == "compile");
+    // 路径排序,保证输出顺序固定
+    std::vector<std::filesystem::path> pdfs;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(chartFolder))
+        if (entry.is_regular_file() && (entry.path().extension() == ".pdf"))
+            pdfs.push_back(entry.path());
+    std::ranges::sort(pdfs);
+    if (mode == "extract") {
+        std::cout << "chart\tpage\tlatitude\tlongitude\tx\ty\tident\n";
+        size_t candidates{0};
+        for (const auto &pdf : pdfs) {
+            for (const auto &point : extractControlPoints(QString::fromStdWString(pdf.wstring()))) {
+                std::cout << std::format("{}\t{}\t{:.7f}\t{:.7f}\t{:.2f}\t{:.2f}\t{}\n", pdf.stem().string(),
+                                         point.page, point.latitude, point.longitude, point.x, point.y,
+                                         point.ident.toStdString());
+                ++candidates;
+            }
+        }
+        std::cerr << std::format("pdfs: {}, candidates: {}\n", pdfs.size(), candidates);
+        return 0;
+    }
+    // 逐份航图并行,结果按序号存放
+    std::vector<ChartReport> reports(pdfs.size());
+    parallelFor(pdfs.size(), 0, [&](const size_t begin, const size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            reports[i] = processChart(pdfs[i], mappingFolder, seed);
+    });
+    std::cout << "chart\tpage\tsource\tpoints\toutliers\trms\n";
+    size_t pages{0}, mapped{0}, extracted{0}, unreadable{0};
+    std::map<std::string, std::vector<const ChartReport *>> airports;
+    for (const auto &report : reports) {
+        if (!report.readable) {
+            std::cout << std::format("{}\t-\tunreadable\t0\t0\t-\n", report.chart);
+            ++unreadable;
+            continue;
+        }
+        airports[report.icao].push_back(&report);
+        for (const auto &page : report.pages) {
+            ++pages;
+            if (page.source == "none") {
+                std::cout << std::format("{}\t{}\tnone\t{}\t0\t-\n", report.chart, page.page, page.points);
+                continue;
+            }
+            ++mapped;
+            extracted += page.source == "text";
+            std::cout << std::format("{}\t{}\t{}\t{}\t{}\t{:.3f}\n", report.chart, page.page, page.source, page.points,
+                                     page.outliers, page.rms);
+        }
+    }
+    size_t written{0};
+    if (build)
+        for (const auto &[icao, charts] : airports)
+            written += writeTmap(mappingFolder / (icao + ".Tmap"), charts);
+    // 编译(在追加之后,保证 .Tbin 与 .Tmap 一致)
+    size_t compiled{0};
+    if (mode == "compile") {
+        std::vector<std::filesystem::path> tmaps;
+        for (const auto &entry : std::filesystem::directory_iterator(mappingFolder))
+            if (entry.is_regular_file() && (entry.path().extension() == ".Tmap"))
+                tmaps.push_back(entry.path());
+        std::vector<char> ok(tmaps.size());
+        parallelFor(tmaps.size(), 0, [&](const size_t begin, const size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i)
+                ok[i] = TbinFile::compile(tmaps[i], std::filesystem::path(tmaps[i]).replace_extension(".Tbin"),
+                                          seed);
+        });
+        compiled = std::ranges::count(ok, 1);
+    }
+    std::cerr << std::format("pdfs: {}, unreadable: {}, pages: {}, mapped: {}, from text: {}, unmapped: {}, written: {}, "
+                             "compiled: {}\n", pdfs.size(), unreadable, pages, mapped, extracted, pages - mapped,
+                             written, compiled);
+    return 0;
+}
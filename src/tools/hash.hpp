@@ -0,0 +1,37 @@
+#ifndef CHARTNAVIGATION_HASH_HPP
+#define CHARTNAVIGATION_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+constexpr uint64_t FNV_OFFSET{0xCBF29CE484222325ULL};
+
+/**
+ * @brief FNV-1a 64位,各平台一致(缓存键/映射文件中的名称哈希依赖此结果,不可修改)
+ * @param hash 上一段的结果(首段传 FNV_OFFSET)
+ */
+inline uint64_t fnv1a (uint64_t hash, const void *bytes, const size_t size) {
+    const auto *p = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief 航图名哈希
+ */
+inline uint64_t nameHash (const std::string_view name) {
+    return fnv1a(FNV_OFFSET, name.data(), name.size());
+}
+
+/**
+ * @brief 单页求解的随机种子,同一(全局种子,航图,页)在各工具中一致
+ */
+inline uint64_t chartPageSeed (const uint64_t seed, const std::string_view chart, const int page) {
+    return seed ^ nameHash(chart) ^ (static_cast<uint64_t>(page) << 32);
+}
+
+#endif //CHARTNAVIGATION_HASH_HPP
@@ -1,5 +1,16 @@
 #include "randomGen.hpp"
 
+#include <random>
+
+namespace
+{
+uint64_t mix (uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+}
+
 /**
  * @brief 生成随机整数 [min,max]
  * @param min 最小
@@ -8,7 +19,40 @@
  */
 int spawnInt (const int min, const int max) {
     thread_local std::random_device rd;
-    static std::mt19937 gen(rd());
+    thread_local std::mt19937 gen(rd());
     std::uniform_int_distribution<int> dis(min, max);
     return dis(gen);
 }
+
+/**
+ * @brief 生成随机种子
+ */
+uint64_t spawnSeed () {
+    thread_local std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+/**
+ * @param seed 基础种子
+ * @param stream 流号(如假设序号)
+ */
+StreamRng::StreamRng (const uint64_t seed, const uint64_t stream) : state(mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ULL))) {}
+
+uint64_t StreamRng::next () {
+    state += 0x9E3779B97F4A7C15ULL;
+    return mix(state);
+}
+
+/**
+ * @brief 均匀整数 [min,max] (Lemire 乘法区间映射,拒绝采样消除偏差)
+ */
+int StreamRng::uniform (const int min, const int max) {
+    const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    uint64_t product = (next() >> 32) * range;
+    if (static_cast<uint32_t>(product) < range) {
+        const uint32_t bound = static_cast<uint32_t>(-static_cast<uint32_t>(range)) % static_cast<uint32_t>(range);
+        while (static_cast<uint32_t>(product) < bound)
+            product = (next() >> 32) * range;
+    }
+    return min + static_cast<int>(product >> 32);
+}
@@ -1,6 +1,22 @@
 #ifndef CHARTNAVIGATION_RANDOMGEN_HPP
 #define CHARTNAVIGATION_RANDOMGEN_HPP
 
+#include <cstdint>
+
 int spawnInt(int min,int max);
+uint64_t spawnSeed();
+
+/**
+ * @brief 计数器式随机流 (splitmix64)
+ * @note 同一(种子,流号)总是产生同一序列,与线程数和调度无关
+ */
+class StreamRng {
+    public:
+        StreamRng (uint64_t seed, uint64_t stream);
+        uint64_t next ();
+        int uniform (int min, int max);
+    private:
+        uint64_t state;
+};
 
-#endif //CHARTNAVIGATION_RANDOMGEN_HPP
\ No newline at end of file
+#endif //CHARTNAVIGATION_RANDOMGEN_HPP
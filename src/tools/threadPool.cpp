@@ -0,0 +1,48 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <latch>
+#include <thread>
+
+/**
+ * @brief 进程共享的计算线程池
+ */
+boost::asio::thread_pool& sharedPool () {
+    static boost::asio::thread_pool pool(poolSize());
+    return pool;
+}
+
+size_t poolSize () {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * @brief 将 [0,count) 均分为若干连续块并行执行,返回时全部完成
+ * @param count 任务总数
+ * @param threads 块数(0为线程池大小)
+ * @param task (begin,end,块序号)
+ * @note 调用线程执行第0块,不能在池内线程中调用
+ */
+void parallelFor (const size_t count, size_t threads, const std::function<void(size_t, size_t, size_t)> &task) {
+    if (threads == 0)
+        threads = poolSize();
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        if (count > 0)
+            task(0, count, 0);
+        return;
+    }
+    std::latch done(static_cast<std::ptrdiff_t>(threads - 1));
+    const auto range = [&](const size_t chunk) { return std::pair{count * chunk / threads, count * (chunk + 1) / threads}; };
+    for (size_t chunk = 1; chunk < threads; ++chunk) {
+        boost::asio::post(sharedPool(), [&, chunk] {
+            const auto [begin, end] = range(chunk);
+            task(begin, end, chunk);
+            done.count_down();
+        });
+    }
+    const auto [begin, end] = range(0);
+    task(begin, end, 0);
+    done.wait();
+}
@@ -0,0 +1,11 @@
+#ifndef CHARTNAVIGATION_THREADPOOL_HPP
+#define CHARTNAVIGATION_THREADPOOL_HPP
+
+#include <boost/asio/thread_pool.hpp>
+#include <functional>
+
+boost::asio::thread_pool& sharedPool ();
+size_t poolSize ();
+void parallelFor (size_t count, size_t threads, const std::function<void(size_t, size_t, size_t)> &task);
+
+#endif //CHARTNAVIGATION_THREADPOOL_HPP
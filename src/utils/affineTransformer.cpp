@@ -1,83 +1,615 @@
 #include "affineTransformer.hpp"
+#include "simdKernel.hpp"
 #include "tools/randomGen.hpp"
+#include "tools/threadPool.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <format>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <ranges>
+#include <span>
 
 
-std::vector<int> findAbnormal_RANSAC (std::vector<std::vector<double>> &values, double threshold);
+std::vector<int> findAbnormal_RANSAC (const PointBuffer &points, double threshold, const RansacOptions &options,
+                                      std::span<const int> order);
+std::optional<std::vector<int>> findAbnormal_IRLS (const PointBuffer &points, double threshold,
+                                                   const RansacOptions &options);
+bool solveWeighted (const PointBuffer &points, std::span<const double> weights, Eigen::Vector3d &paramsX,
+                    Eigen::Vector3d &paramsY);
+bool robustStart (const PointBuffer &points, double threshold, const RansacOptions &options, Eigen::Vector3d &paramsX,
+                  Eigen::Vector3d &paramsY);
+int requiredIterations (double inlierRatio, double confidence, int maxIterations);
+size_t localOptimize (const PointBuffer &points, double thresholdSq, std::vector<uint64_t> &bestMask,
+                      std::vector<uint64_t> &scratch, size_t count);
+bool solveMinimal (const PointBuffer &points, int a, int b, int c, Eigen::Vector3d &paramsX, Eigen::Vector3d &paramsY);
 
 
+/**
+ * @brief 3点闭式求解仿射参数
+ * @param points 控制点
+ * @param a,b,c 样本索引
+ * @param paramsX x参数
+ * @param paramsY y参数
+ * @return 样本是否非退化(三点不共线)
+ * @note 以a点为原点解2x2方程,x,y共用同一个逆矩阵,全程在栈上
+ */
+bool solveMinimal (const PointBuffer &points, const int a, const int b, const int c,
+                   Eigen::Vector3d &paramsX, Eigen::Vector3d &paramsY) {
+    const double u1 = points.lon[b] - points.lon[a], v1 = points.lat[b] - points.lat[a];
+    const double u2 = points.lon[c] - points.lon[a], v2 = points.lat[c] - points.lat[a];
+    const double det = u1 * v2 - u2 * v1;
+    // 共线:两边叉积相对边长过小
+    if (std::abs(det) <= 1e-6 * (u1 * u1 + v1 * v1 + u2 * u2 + v2 * v2))
+        return false;
+    const double inv = 1 / det;
+    const auto solve = [&](const std::vector<double> &target, Eigen::Vector3d &params) {
+        const double t1 = target[b] - target[a], t2 = target[c] - target[a];
+        params(0) = (t1 * v2 - t2 * v1) * inv;
+        params(1) = (u1 * t2 - u2 * t1) * inv;
+        params(2) = target[a] - params(0) * points.lon[a] - params(1) * points.lat[a];
+    };
+    solve(points.x, paramsX);
+    solve(points.y, paramsY);
+    return true;
+}
+
+
+/**
+ * @brief 达到置信度所需的迭代次数
+ * @param inlierRatio 当前内点比例
+ * @param confidence 置信度
+ * @param maxIterations 上限
+ */
+int requiredIterations (const double inlierRatio, const double confidence, const int maxIterations) {
+    const double allInlier = inlierRatio * inlierRatio * inlierRatio; // 3点全为内点的概率
+    if (allInlier >= 1)
+        return 0;
+    if (allInlier <= 0)
+        return maxIterations;
+    const double required = std::ceil(std::log(1 - confidence) / std::log(1 - allInlier));
+    return static_cast<int>(std::min(required, static_cast<double>(maxIterations)));
+}
+
+/**
+ * @brief PROSAC渐进采样:先从质量最好的少量点中采样,逐步扩大到全部点
+ */
+class ProgressiveSampler {
+    public:
+        ProgressiveSampler (const std::span<const int> order, const int maxIterations) : order(order) {
+            const double n = static_cast<double>(order.size());
+            tn = maxIterations * 6 / (n * (n - 1) * (n - 2)); // T_m, m=3
+        }
+
+        void sample (StreamRng &rng, int &a, int &b, int &c) {
+            ++t;
+            if ((t > tnPrime) && (subset < order.size())) {
+                ++subset;
+                const double next = tn * static_cast<double>(subset) / static_cast<double>(subset - 3);
+                tnPrime += std::ceil(next - tn);
+                tn = next;
+            }
+            const int pool = static_cast<int>(subset);
+            // 通常:最新加入的点 + 之前子集中的2个点;计划次数用尽后在整个子集中采样
+            const bool forced = tnPrime >= t;
+            const int range = forced ? pool - 2 : pool - 1;
+            c = forced ? pool - 1 : rng.uniform(0, range);
+            do a = rng.uniform(0, range);
+            while (a == c);
+            do b = rng.uniform(0, range);
+            while ((b == a) || (b == c));
+            a = order[a];
+            b = order[b];
+            c = order[c];
+        }
+    private:
+        std::span<const int> order;
+        size_t subset{3};
+        double tn;
+        double tnPrime{1};
+        int t{0};
+};
+
+/**
+ * @brief 局部优化:用内点集最小二乘重拟合并重新计分,直到内点不再增加
+ * @return 优化后内点数量
+ */
+size_t localOptimize (const PointBuffer &points, const double thresholdSq, std::vector<uint64_t> &bestMask,
+                      std::vector<uint64_t> &scratch, size_t count) {
+    constexpr int rounds = 4;
+    std::vector<int> inliers;
+    for (int round = 0; round < rounds; ++round) {
+        inliers.clear();
+        for (size_t i = 0; i < points.size(); ++i)
+            if (testBit(bestMask, i))
+                inliers.push_back(static_cast<int>(i));
+        auto view = inliers | std::views::transform([&](const int j) {
+            return ControlPoint{points.lat[j], points.lon[j], points.x[j], points.y[j]};
+        });
+        auto [pX,pY] = doAffine(view);
+        const size_t refined = countInliers(points, pX, pY, thresholdSq, scratch.data());
+        if (refined <= count)
+            break;
+        count = refined;
+        std::swap(bestMask, scratch);
+    }
+    return count;
+}
+
 /**
  * @brief 基于RANSAC算法筛选异常值
- * @param values 原始值列表
+ * @param points 控制点(SoA)
  * @param threshold 异常阈值
+ * @param options 参数
+ * @param order 按质量从高到低排列的索引(为空则均匀采样)
  * @return 异常值位置列表
- * @note 迭代次数增加意义较小,且在release下耗时较少
+ * @note 迭代次数由当前内点比例与置信度自适应决定,干净的数据只需几次迭代
+ * @note 假设按固定大小分批并行计分,同一种子在任意核心数下结果相同
  */
-std::vector<int> findAbnormal_RANSAC (std::vector<std::vector<double>> &values, const double threshold) {
-    const size_t n = values.size(); // 数据量
-    constexpr int iterations = 200; // 迭代次数
+std::vector<int> findAbnormal_RANSAC (const PointBuffer &points, const double threshold, const RansacOptions &options,
+                                      const std::span<const int> order) {
+    constexpr int batchSize = 32; // 每批假设数,与线程数无关
+    constexpr size_t parallelPoints = 256; // 点数较少时线程调度开销大于计分
+    const size_t n = points.size(); // 数据量
+    const int last = static_cast<int>(n) - 1;
+    const uint64_t seed = options.seed ? options.seed : spawnSeed();
+    const size_t threads = n < parallelPoints ? 1 : options.threads;
+    int iterations = options.maxIterations; // 迭代次数
+    const double thresholdSq = threshold * threshold;
     size_t maxInnerCount = 0; // 最大内点数量
-    std::set<int> bestInnerIdxes; // 最优内点索引
-    // 迭代循环
-    for (int i = 0; i < iterations; ++i) {
-        // 随机选择点作为样本
-        std::set<int> samples;
-        while (samples.size() < 3)
-            samples.insert(spawnInt(0, static_cast<int>(n) - 1));
-        // 仿射变换
-        auto view = samples | std::views::transform([&](const int j) -> std::vector<double>& { return values[j]; });
-        auto [pX,pY] = doAffine(view);
-        // 计算内点
-        std::set<int> currentInnerIdxes;
-        for (int j = 0; j < n; ++j) {
-            const double lon = values[j][1], lat = values[j][0];
-            const double xT = values[j][2], yT = values[j][3];
-            const double xP = pX(0) * lon + pX(1) * lat + pX(2);
-            const double yP = pY(0) * lon + pY(1) * lat + pY(2);
-            if (std::pow(xP - xT, 2) + std::pow(yP - yT, 2) < std::pow(threshold, 2))
-                currentInnerIdxes.insert(j);
+    const size_t words = (n + 63) / 64;
+    std::vector<uint64_t> currentMask(words), bestMask(words); // 内点位掩码
+    std::optional<ProgressiveSampler> sampler;
+    if (options.progressive && (order.size() == n) && (n > 3))
+        sampler.emplace(order, options.maxIterations);
+    struct Hypothesis {
+        int a, b, c;
+        Eigen::Vector3d pX, pY;
+        size_t count;
+    };
+    std::array<Hypothesis, batchSize> batch;
+    std::vector<std::vector<uint64_t>> scratch(threads == 0 ? poolSize() : threads, std::vector<uint64_t>(words));
+    // 按批迭代,批之间更新最优与迭代次数
+    for (int first = 0; first < iterations; first += batchSize) {
+        const int size = std::min(batchSize, iterations - first);
+        // 采样在调用线程按序号顺序进行,第k个假设只取决于(种子,k)
+        for (int k = 0; k < size; ++k) {
+            StreamRng rng(seed, first + k);
+            auto &[a, b, c, pX, pY, count] = batch[k];
+            if (sampler)
+                sampler->sample(rng, a, b, c);
+            else {
+                a = rng.uniform(0, last);
+                do b = rng.uniform(0, last);
+                while (b == a);
+                do c = rng.uniform(0, last);
+                while ((c == a) || (c == b));
+            }
         }
+        // 仿射变换并计算内点
+        parallelFor(size, threads, [&](const size_t begin, const size_t end, const size_t chunk) {
+            for (size_t k = begin; k < end; ++k) {
+                auto &[a, b, c, pX, pY, count] = batch[k];
+                count = solveMinimal(points, a, b, c, pX, pY)
+                            ? countInliers(points, pX, pY, thresholdSq, scratch[chunk].data())
+                            : 0;
+            }
+        });
+        // 归约:内点最多者,相同时序号小者优先
+        const Hypothesis *best = nullptr;
+        for (int k = 0; k < size; ++k)
+            if (batch[k].count > (best ? best->count : maxInnerCount))
+                best = &batch[k];
         // 更新最优
-        if (currentInnerIdxes.size() > maxInnerCount) {
-            maxInnerCount = currentInnerIdxes.size();
-            bestInnerIdxes = currentInnerIdxes;
+        if (best) {
+            maxInnerCount = countInliers(points, best->pX, best->pY, thresholdSq, bestMask.data());
+            if (options.localOptimization && (maxInnerCount >= 3))
+                maxInnerCount = localOptimize(points, thresholdSq, bestMask, currentMask, maxInnerCount);
+            iterations = std::min(iterations, requiredIterations(static_cast<double>(maxInnerCount) / n,
+                                                                 options.confidence, options.maxIterations));
         }
-        // 覆盖95%
-        if (static_cast<double>(maxInnerCount) > static_cast<double>(n) * 0.95)
-            break;
     }
     // 找出离群点索引
     std::vector<int> abnormalValues;
     for (int i = 0; i < n; ++i) {
-        if (!bestInnerIdxes.contains(i))
+        if (!testBit(bestMask, i))
             abnormalValues.push_back(i);
     }
     return abnormalValues;
 }
 
+/**
+ * @brief 加权最小二乘仿射(去质心的2x2法方程)
+ * @param points 控制点
+ * @param weights 权重
+ * @param paramsX x参数
+ * @param paramsY y参数
+ * @return 是否可解(有效点不共线)
+ */
+bool solveWeighted (const PointBuffer &points, const std::span<const double> weights, Eigen::Vector3d &paramsX,
+                    Eigen::Vector3d &paramsY) {
+    const size_t n = points.size();
+    double sw{0}, meanLon{0}, meanLat{0}, meanX{0}, meanY{0};
+    for (size_t i = 0; i < n; ++i) {
+        const double w = weights[i];
+        sw += w;
+        meanLon += w * points.lon[i];
+        meanLat += w * points.lat[i];
+        meanX += w * points.x[i];
+        meanY += w * points.y[i];
+    }
+    if (sw <= 0)
+        return false;
+    meanLon /= sw;
+    meanLat /= sw;
+    meanX /= sw;
+    meanY /= sw;
+    Eigen::Matrix2d normal = Eigen::Matrix2d::Zero();
+    Eigen::Matrix2d rhs = Eigen::Matrix2d::Zero();
+    for (size_t i = 0; i < n; ++i) {
+        const double w = weights[i];
+        const double u = points.lon[i] - meanLon, v = points.lat[i] - meanLat;
+        const double dx = points.x[i] - meanX, dy = points.y[i] - meanY;
+        normal(0, 0) += w * u * u;
+        normal(0, 1) += w * u * v;
+        normal(1, 1) += w * v * v;
+        rhs(0, 0) += w * u * dx;
+        rhs(1, 0) += w * v * dx;
+        rhs(0, 1) += w * u * dy;
+        rhs(1, 1) += w * v * dy;
+    }
+    normal(1, 0) = normal(0, 1);
+    // 共线:行列式相对迹过小
+    const double trace = normal(0, 0) + normal(1, 1);
+    if (normal.determinant() <= 1e-12 * trace * trace)
+        return false;
+    const Eigen::Matrix2d ab = normal.ldlt().solve(rhs);
+    paramsX = {ab(0, 0), ab(1, 0), meanX - ab(0, 0) * meanLon - ab(1, 0) * meanLat};
+    paramsY = {ab(0, 1), ab(1, 1), meanY - ab(0, 1) * meanLon - ab(1, 1) * meanLat};
+    return true;
+}
+
+/**
+ * @brief IRLS的稳健初值:在少量分散的3点组合中取内点最多者,相同时取截断残差平方和最小者
+ * @param points 控制点
+ * @param threshold 截断阈值
+ * @param options 置信度
+ * @note 远离的杠杆点会把普通最小二乘初值拉偏,M估计无法从那里恢复
+ * @note 组合数固定不超过 START_TRIALS(IRLS只用于少量点,点数少时直接穷举),按置信度提前结束,干净数据取一组即可
+ * @note 每组从固定种子的随机流中抽 START_DRAWS 个候选,取经纬度三角形面积最大者,避免近共线组合外推失真
+ */
+bool robustStart (const PointBuffer &points, const double threshold, const RansacOptions &options,
+                  Eigen::Vector3d &paramsX, Eigen::Vector3d &paramsY) {
+    constexpr uint64_t fixedSeed = 0x9E3779B97F4A7C15ULL; // 固定种子,结果不随运行变化
+    constexpr int START_TRIALS{32}, START_DRAWS{4};
+    const int n = static_cast<int>(points.size());
+    if (n < 3)
+        return false;
+    const double thresholdSq = threshold * threshold;
+    const auto score = [&](const Eigen::Vector3d &pX, const Eigen::Vector3d &pY) {
+        double sum{0};
+        for (int i = 0; i < n; ++i) {
+            const double dx = pX(0) * points.lon[i] + pX(1) * points.lat[i] + pX(2) - points.x[i];
+            const double dy = pY(0) * points.lon[i] + pY(1) * points.lat[i] + pY(2) - points.y[i];
+            sum += std::min(dx * dx + dy * dy, thresholdSq);
+        }
+        return sum;
+    };
+    std::vector<uint64_t> mask((points.size() + 63) / 64);
+    size_t bestCount{0};
+    double best = std::numeric_limits<double>::infinity();
+    const auto consider = [&](const int a, const int b, const int c) {
+        Eigen::Vector3d pX, pY;
+        if (!solveMinimal(points, a, b, c, pX, pY))
+            return;
+        const size_t count = countInliers(points, pX, pY, thresholdSq, mask.data());
+        if (count < bestCount)
+            return;
+        if (const double s = score(pX, pY); (count > bestCount) || (s < best)) {
+            bestCount = count;
+            best = s;
+            paramsX = pX;
+            paramsY = pY;
+        }
+    };
+    // 组合数不超过上限时穷举
+    if (static_cast<int64_t>(n) * (n - 1) * (n - 2) / 6 <= START_TRIALS) {
+        for (int a = 0; a < n; ++a)
+            for (int b = a + 1; b < n; ++b)
+                for (int c = b + 1; c < n; ++c)
+                    consider(a, b, c);
+        return std::isfinite(best);
+    }
+    const auto area = [&](const int a, const int b, const int c) {
+        return std::abs((points.lon[b] - points.lon[a]) * (points.lat[c] - points.lat[a]) -
+                        (points.lon[c] - points.lon[a]) * (points.lat[b] - points.lat[a]));
+    };
+    int trials = START_TRIALS;
+    for (int k = 0; k < trials; ++k) {
+        StreamRng rng(fixedSeed, k);
+        std::array<int, 3> sample{};
+        double sampleArea{-1};
+        for (int draw = 0; draw < START_DRAWS; ++draw) {
+            const int a = rng.uniform(0, n - 1);
+            int b, c;
+            do b = rng.uniform(0, n - 1);
+            while (b == a);
+            do c = rng.uniform(0, n - 1);
+            while ((c == a) || (c == b));
+            if (const double s = area(a, b, c); s > sampleArea) {
+                sampleArea = s;
+                sample = {a, b, c};
+            }
+        }
+        consider(sample[0], sample[1], sample[2]);
+        if (bestCount >= 3)
+            trials = std::min(trials, requiredIterations(static_cast<double>(bestCount) / n, options.confidence,
+                                                         START_TRIALS));
+    }
+    return std::isfinite(best);
+}
+
+/**
+ * @brief 基于迭代重加权最小二乘(IRLS)筛选异常值
+ * @param points 控制点(SoA)
+ * @param threshold 异常阈值
+ * @param options 参数(权函数,迭代上限)
+ * @return 异常值位置列表,无法求解时为空
+ * @note 从稳健初值出发,尺度由初值残差确定后固定(MM估计),避免降权不足时尺度与参数互相放大
+ * @note 尺度取残差中位数的1.4826倍,下限为阈值的1/4;不依赖种子,同一输入结果总是相同
+ */
+std::optional<std::vector<int>> findAbnormal_IRLS (const PointBuffer &points, const double threshold,
+                                                   const RansacOptions &options) {
+    constexpr double huberK = 1.345, tukeyC = 4.685; // 95%效率常数
+    constexpr double tolerance = 1e-6; // 收敛:预测位置变化(点)
+    const size_t n = points.size();
+    std::vector<double> weights(n, 1), residuals(n), scratch(n);
+    Eigen::Vector3d pX, pY;
+    if (!robustStart(points, threshold, options, pX, pY))
+        return std::nullopt;
+    const auto computeResiduals = [&] {
+        for (size_t i = 0; i < n; ++i) {
+            const double dx = pX(0) * points.lon[i] + pX(1) * points.lat[i] + pX(2) - points.x[i];
+            const double dy = pY(0) * points.lon[i] + pY(1) * points.lat[i] + pY(2) - points.y[i];
+            residuals[i] = std::hypot(dx, dy);
+        }
+    };
+    computeResiduals();
+    std::ranges::copy(residuals, scratch.begin());
+    std::ranges::nth_element(scratch, scratch.begin() + static_cast<std::ptrdiff_t>(n / 2));
+    const double scale = std::max(1.4826 * scratch[n / 2], threshold / 4);
+    for (int iteration = 0; iteration < options.irlsIterations; ++iteration) {
+        for (size_t i = 0; i < n; ++i) {
+            const double r = residuals[i];
+            if (options.loss == RobustLoss::Huber) {
+                const double k = huberK * scale;
+                weights[i] = r <= k ? 1 : k / r;
+            } else {
+                const double t = r / (tukeyC * scale);
+                weights[i] = t < 1 ? (1 - t * t) * (1 - t * t) : 0;
+            }
+        }
+        Eigen::Vector3d nX, nY;
+        if (!solveWeighted(points, weights, nX, nY))
+            break; // 保留上一次的解
+        double change{0};
+        for (size_t i = 0; i < n; ++i) {
+            const double dx = (nX(0) - pX(0)) * points.lon[i] + (nX(1) - pX(1)) * points.lat[i] + nX(2) - pX(2);
+            const double dy = (nY(0) - pY(0)) * points.lon[i] + (nY(1) - pY(1)) * points.lat[i] + nY(2) - pY(2);
+            change = std::max(change, std::max(std::abs(dx), std::abs(dy)));
+        }
+        pX = nX;
+        pY = nY;
+        if (change < tolerance)
+            break;
+        computeResiduals();
+    }
+    std::vector<uint64_t> mask((n + 63) / 64);
+    countInliers(points, pX, pY, threshold * threshold, mask.data());
+    std::vector<int> abnormalValues;
+    for (size_t i = 0; i < n; ++i)
+        if (!testBit(mask, i))
+            abnormalValues.push_back(static_cast<int>(i));
+    return abnormalValues;
+}
+
 /**
  * @brief 加载数据
- * @param dataList [[纬度,经度,x,y], ...]
+ * @param dataList 控制点
  * @param threshold
+ * @param options 筛选参数
  * @return 数据是否可用
+ * @note Auto 模式下少量点用IRLS;IRLS保留的点不足一半(异常值过多)时改用RANSAC
  */
-bool AffineTransformer::loadData (const std::vector<std::vector<double>> &dataList, double threshold) {
-    data = dataList;
+bool AffineTransformer::loadData (const std::span<const ControlPoint> dataList, double threshold,
+                                  const RansacOptions &options) {
+    data.assign(dataList.begin(), dataList.end());
+    source.assign(dataList.begin(), dataList.end());
+    dataDirty = false;
+    inlierMask.assign((dataList.size() + 63) / 64, ~uint64_t{0});
+    if (const size_t tail = dataList.size() & 63; tail != 0)
+        inlierMask.back() = (uint64_t{1} << tail) - 1;
     // 第一次变换
-    if (!fitAffine())
+    if (!fitAffine()) {
+        rebuildIncremental(); // 点数不足时仍可继续编辑
         return false;
-    auto idxes = findAbnormal_RANSAC(data, threshold);
+    }
+    PointBuffer points;
+    points.reserve(data.size());
+    for (const auto &point : data)
+        points.push(point.latitude, point.longitude, point.x, point.y);
+    const bool irls = (options.engine == RobustEngine::Irls) ||
+                      ((options.engine == RobustEngine::Auto) && (data.size() <= options.irlsMaxPoints));
+    if (irls) {
+        auto idxes = findAbnormal_IRLS(points, threshold, options);
+        const bool accepted = idxes && ((options.engine == RobustEngine::Irls) || (idxes->size() * 2 <= data.size()));
+        if (accepted) {
+            for (const auto idx : *idxes)
+                inlierMask[idx >> 6] &= ~(uint64_t{1} << (idx & 63));
+            filterInliers();
+            rebuildIncremental();
+            return fitAffine();
+        }
+    }
+    // PROSAC质量:初次拟合残差越小越可信
+    std::vector<int> order;
+    if (options.progressive) {
+        std::vector<double> residuals;
+        residuals.reserve(data.size());
+        for (const auto &point : data) {
+            auto [x, y] = transform(point.latitude, point.longitude);
+            residuals.push_back(std::hypot(x - point.x, y - point.y));
+        }
+        order.resize(data.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, {}, [&](const int i) { return residuals[i]; });
+    }
+    for (const auto idx : findAbnormal_RANSAC(points, threshold, options, order))
+        inlierMask[idx >> 6] &= ~(uint64_t{1} << (idx & 63));
     // 第二次变换
-    std::ranges::sort(idxes, std::ranges::greater{});
-    for (const auto idx : idxes)
-        data.erase(data.begin() + idx);
+    filterInliers();
+    rebuildIncremental();
     return fitAffine();
 }
 
+/**
+ * @brief 直接载入已拟合的结果(跳过求解)
+ * @param dataList 控制点
+ * @param fit 拟合结果
+ * @return 数据是否可用
+ */
+bool AffineTransformer::loadFit (const std::span<const ControlPoint> dataList, const AffineFit &fit) {
+    if (fit.inlierMask.size() != (dataList.size() + 63) / 64)
+        return false;
+    source.assign(dataList.begin(), dataList.end());
+    inlierMask = fit.inlierMask;
+    filterInliers();
+    dataDirty = false;
+    if (data.size() < 3)
+        return false;
+    paramsX = fit.paramsX;
+    paramsY = fit.paramsY;
+    rebuildIncremental();
+    return true;
+}
+
+/**
+ * @brief 增加控制点(视为内点),参数立即更新
+ * @param point 控制点
+ * @return 变换是否可用
+ * @note 编辑只更新法方程累加量,不重新筛选异常值
+ */
+bool AffineTransformer::addPoint (const ControlPoint &point) {
+    const size_t idx = source.size();
+    source.push_back(point);
+    if (inlierMask.size() * 64 <= idx)
+        inlierMask.push_back(0);
+    inlierMask[idx >> 6] |= uint64_t{1} << (idx & 63);
+    incremental.add(point.latitude, point.longitude, point.x, point.y);
+    dataDirty = true;
+    return refreshParams();
+}
+
+/**
+ * @brief 移动控制点(移动后视为内点)
+ * @param index 控制点索引
+ * @param point 控制点
+ * @return 变换是否可用
+ */
+bool AffineTransformer::movePoint (const size_t index, const ControlPoint &point) {
+    if (index >= source.size())
+        return false;
+    const auto &old = source[index];
+    if (testBit(inlierMask, index))
+        incremental.remove(old.latitude, old.longitude, old.x, old.y);
+    else
+        inlierMask[index >> 6] |= uint64_t{1} << (index & 63);
+    source[index] = point;
+    incremental.add(point.latitude, point.longitude, point.x, point.y);
+    dataDirty = true;
+    return refreshParams();
+}
+
+/**
+ * @brief 删除控制点
+ * @param index 控制点索引
+ * @return 变换是否可用
+ */
+bool AffineTransformer::removePoint (const size_t index) {
+    if (index >= source.size())
+        return false;
+    const auto &old = source[index];
+    if (testBit(inlierMask, index))
+        incremental.remove(old.latitude, old.longitude, old.x, old.y);
+    source.erase(source.begin() + static_cast<std::ptrdiff_t>(index));
+    // 位掩码整体前移一位
+    const size_t word = index >> 6;
+    const uint64_t lowMask = (uint64_t{1} << (index & 63)) - 1;
+    inlierMask[word] = (inlierMask[word] & lowMask) | ((inlierMask[word] >> 1) & ~lowMask);
+    for (size_t w = word + 1; w < inlierMask.size(); ++w) {
+        inlierMask[w - 1] |= (inlierMask[w] & 1) << 63;
+        inlierMask[w] >>= 1;
+    }
+    inlierMask.resize((source.size() + 63) / 64);
+    dataDirty = true;
+    return refreshParams();
+}
+
+/**
+ * @brief 由增量累加量求解参数
+ */
+bool AffineTransformer::refreshParams () {
+    Eigen::Vector3d x, y;
+    if (!incremental.solve(x, y))
+        return false;
+    paramsX = x;
+    paramsY = y;
+    return true;
+}
+
+/**
+ * @brief 以当前内点重建增量累加量
+ */
+void AffineTransformer::rebuildIncremental () {
+    incremental.clear();
+    for (const auto &point : data)
+        incremental.add(point.latitude, point.longitude, point.x, point.y);
+}
+
+/**
+ * @brief 编辑后按位掩码重建内点列表
+ */
+void AffineTransformer::syncData () {
+    if (!dataDirty)
+        return;
+    filterInliers();
+    dataDirty = false;
+}
+
+/**
+ * @brief 按位掩码从全部控制点中取出内点
+ * @note 单趟稳定划分(异常值直接丢弃),复用 data 的容量,不逐点分配
+ */
+void AffineTransformer::filterInliers () {
+    data.resize(source.size());
+    size_t kept{0};
+    for (size_t i = 0; i < source.size(); ++i)
+        if (testBit(inlierMask, i))
+            data[kept++] = source[i];
+    data.resize(kept);
+}
+
+/**
+ * @brief 当前拟合结果
+ */
+AffineFit AffineTransformer::result () {
+    return {paramsX, paramsY, inlierMask, evaluate().first};
+}
+
 /**
  * @brief 转换经纬度至平面坐标系
  * @param latitude 纬度
@@ -90,19 +622,79 @@ std::pair<double, double> AffineTransformer::transform (const double latitude, c
     return {x, y};
 }
 
+/**
+ * @brief 批量转换经纬度至平面坐标系(SoA)
+ * @param latitude 纬度
+ * @param longitude 经度
+ * @param x 输出x
+ * @param y 输出y
+ * @note 按最短的span处理
+ */
+void AffineTransformer::transform (const std::span<const double> latitude, const std::span<const double> longitude,
+                                   const std::span<double> x, const std::span<double> y) const {
+    const size_t n = std::min({latitude.size(), longitude.size(), x.size(), y.size()});
+    affineBatch(forwardParams().data(), longitude.data(), latitude.data(), x.data(), y.data(), n);
+}
+
+void AffineTransformer::transform (const std::span<const float> latitude, const std::span<const float> longitude,
+                                   const std::span<float> x, const std::span<float> y) const {
+    const size_t n = std::min({latitude.size(), longitude.size(), x.size(), y.size()});
+    affineBatch(forwardParams().data(), longitude.data(), latitude.data(), x.data(), y.data(), n);
+}
+
+/**
+ * @brief 批量转换平面坐标至经纬度(SoA)
+ * @param x 输入x
+ * @param y 输入y
+ * @param latitude 输出纬度
+ * @param longitude 输出经度
+ */
+void AffineTransformer::inverse (const std::span<const double> x, const std::span<const double> y,
+                                 const std::span<double> latitude, const std::span<double> longitude) const {
+    const size_t n = std::min({latitude.size(), longitude.size(), x.size(), y.size()});
+    affineBatch(inverseParams().data(), x.data(), y.data(), longitude.data(), latitude.data(), n);
+}
+
+void AffineTransformer::inverse (const std::span<const float> x, const std::span<const float> y,
+                                 const std::span<float> latitude, const std::span<float> longitude) const {
+    const size_t n = std::min({latitude.size(), longitude.size(), x.size(), y.size()});
+    affineBatch(inverseParams().data(), x.data(), y.data(), longitude.data(), latitude.data(), n);
+}
+
+/**
+ * @brief 正变换参数 (经度,纬度)->(x,y)
+ */
+std::array<double, 6> AffineTransformer::forwardParams () const {
+    return {paramsX(0), paramsX(1), paramsX(2), paramsY(0), paramsY(1), paramsY(2)};
+}
+
+/**
+ * @brief 逆变换参数 (x,y)->(经度,纬度),由2x2线性部分求逆
+ */
+std::array<double, 6> AffineTransformer::inverseParams () const {
+    const double det = paramsX(0) * paramsY(1) - paramsX(1) * paramsY(0);
+    const double i00 = paramsY(1) / det, i01 = -paramsX(1) / det;
+    const double i10 = -paramsY(0) / det, i11 = paramsX(0) / det;
+    return {
+        i00, i01, -(i00 * paramsX(2) + i01 * paramsY(2)),
+        i10, i11, -(i10 * paramsX(2) + i11 * paramsY(2))
+    };
+}
+
 /**
  * @brief 评估仿射变换效果
  * @param print 是否输出至控制台
  * @return 均方根误差,误差列表
  */
 std::pair<double, std::vector<double>> AffineTransformer::evaluate (const bool print) {
+    syncData();
     double totalError{}, sumSquaredError{}, maxError{};
     double minError = std::numeric_limits<double>::infinity();
     const int n = static_cast<int>(data.size());
     std::vector<double> errors;
     errors.reserve(n);
-    for (const auto &row : data) {
-        const double lat{row[0]}, lon{row[1]}, xTrue{row[2]}, yTrue{row[3]};
+    for (const auto &point : data) {
+        const double lat{point.latitude}, lon{point.longitude}, xTrue{point.x}, yTrue{point.y};
         auto [xPred, yPred] = transform(lat, lon);
         const double dx = xPred - xTrue;
         const double dy = yPred - yTrue;
@@ -1,54 +1,148 @@
 #ifndef CHARTNAVIGATION_AFFINETRANSFORMER_HPP
 #define CHARTNAVIGATION_AFFINETRANSFORMER_HPP
 
+#include <array>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <type_traits>
 #include <vector>
 #include <Eigen/Dense>
 
+#include "controlPoint.hpp"
+#include "incrementalAffine.hpp"
+
 template <typename R>
 concept DataContainer = std::ranges::forward_range<R> &&
-        std::same_as<std::ranges::range_value_t<R>, std::vector<double>>;
+        std::same_as<std::remove_cvref_t<std::ranges::range_reference_t<R>>, ControlPoint>;
+
+
+template <DataContainer R>
+std::pair<Eigen::Vector3d, Eigen::Vector3d> doAffine (R &&data);
+
+/**
+ * @brief 异常值筛选算法
+ */
+enum class RobustEngine {
+    Ransac, // 随机采样一致
+    Irls, // 迭代重加权最小二乘(确定性)
+    Auto // 点数不超过 irlsMaxPoints 时用IRLS,否则RANSAC
+};
+
+/**
+ * @brief IRLS权函数
+ */
+enum class RobustLoss {
+    Huber, // 远离的点降权
+    Tukey // 远离的点权重为0
+};
 
+/**
+ * @brief 异常值筛选参数
+ */
+struct RansacOptions {
+    double confidence{0.99}; // 置信度,决定自适应迭代次数
+    int maxIterations{1000}; // 迭代上限
+    bool localOptimization{true}; // 对新的最优内点集做局部优化 (LO-RANSAC)
+    bool progressive{true}; // 按初次拟合残差排序渐进采样 (PROSAC)
+    size_t threads{0}; // 并行线程数(0为全部核心,1为单线程)
+    uint64_t seed{0}; // 随机种子(0为每次随机)
+    RobustEngine engine{RobustEngine::Auto};
+    RobustLoss loss{RobustLoss::Tukey};
+    size_t irlsMaxPoints{40}; // Auto 模式下使用IRLS的点数上限
+    int irlsIterations{20}; // IRLS每个阶段的迭代上限
+};
 
-template <typename DataContainer>
-std::pair<Eigen::Vector3d, Eigen::Vector3d> doAffine (DataContainer &&data);
+/**
+ * @brief 拟合结果
+ */
+struct AffineFit {
+    Eigen::Vector3d paramsX, paramsY;
+    std::vector<uint64_t> inlierMask; // 原始控制点的内点位掩码
+    double rms; // 内点均方根误差
+};
 
 class AffineTransformer {
     public:
-        bool loadData (const std::vector<std::vector<double>> &dataList, double threshold);
+        bool loadData (std::span<const ControlPoint> dataList, double threshold, const RansacOptions &options = {});
+        bool loadFit (std::span<const ControlPoint> dataList, const AffineFit &fit);
+        AffineFit result ();
+        bool addPoint (const ControlPoint &point);
+        bool movePoint (size_t index, const ControlPoint &point);
+        bool removePoint (size_t index);
+        [[nodiscard]] std::span<const ControlPoint> controlPoints () const { return source; }
+        [[nodiscard]] const std::vector<uint64_t>& inliers () const { return inlierMask; }
+        [[nodiscard]] std::pair<Eigen::Vector3d, Eigen::Vector3d> parameters () const { return {paramsX, paramsY}; }
         std::pair<double, double> transform (double latitude, double longitude);
+        void transform (std::span<const double> latitude, std::span<const double> longitude, std::span<double> x,
+                        std::span<double> y) const;
+        void transform (std::span<const float> latitude, std::span<const float> longitude, std::span<float> x,
+                        std::span<float> y) const;
+        void inverse (std::span<const double> x, std::span<const double> y, std::span<double> latitude,
+                      std::span<double> longitude) const;
+        void inverse (std::span<const float> x, std::span<const float> y, std::span<float> latitude,
+                      std::span<float> longitude) const;
         std::pair<double, std::vector<double>> evaluate (bool print = false);
     private:
         bool fitAffine ();
+        bool refreshParams ();
+        void rebuildIncremental ();
+        void syncData ();
+        void filterInliers ();
+        [[nodiscard]] std::array<double, 6> forwardParams () const;
+        [[nodiscard]] std::array<double, 6> inverseParams () const;
 
-        std::vector<std::vector<double>> data{};
+        std::vector<ControlPoint> data{}; // 内点(按原顺序)
+        std::vector<ControlPoint> source{}; // 全部控制点
+        std::vector<uint64_t> inlierMask{};
+        IncrementalAffine incremental{}; // 内点的法方程累加量
+        bool dataDirty{false}; // 编辑后 data 需按位掩码重建
         Eigen::Vector3d paramsX{}, paramsY{};
 };
 
 
 /**
- * @brief 计算仿射变换参数
- * @param data 比如vector<vector<>> 其中每个元素为 {lati,longi,x,y}
+ * @brief 计算仿射变换参数(最小二乘)
+ * @param data 控制点序列(容器或视图)
  * @return x,y参数
  * @note RANSAC计算参数需要变换,所以独立出来
+ * @note 坐标先减去质心再建立固定尺寸的法方程,x,y共用一次分解
  */
-template <typename DataContainer>
-std::pair<Eigen::Vector3d, Eigen::Vector3d> doAffine (DataContainer &&data) {
-    auto begin = data.begin();
-    auto end = data.end();
-    const int n = std::ranges::distance(begin, end);
-    Eigen::MatrixXd A(n, 3);
-    Eigen::VectorXd B_x(n), B_y(n);
-    int counter{0};
-    for (auto &item : data) {
-        A(counter, 0) = item[1];
-        A(counter, 1) = item[0];
-        A(counter, 2) = 1;
-        B_x(counter) = item[2];
-        B_y(counter) = item[3];
-        ++counter;
+template <DataContainer R>
+std::pair<Eigen::Vector3d, Eigen::Vector3d> doAffine (R &&data) {
+    // 质心
+    double n{0}, meanLon{0}, meanLat{0}, meanX{0}, meanY{0};
+    for (const auto &item : data) {
+        meanLon += item.longitude;
+        meanLat += item.latitude;
+        meanX += item.x;
+        meanY += item.y;
+        ++n;
+    }
+    meanLon /= n;
+    meanLat /= n;
+    meanX /= n;
+    meanY /= n;
+    // 法方程 [Suu Suv; Suv Svv] [a b]^T = [Sux Svx] / [Suy Svy]
+    Eigen::Matrix2d normal = Eigen::Matrix2d::Zero();
+    Eigen::Matrix2d rhs = Eigen::Matrix2d::Zero(); // 第0列x,第1列y
+    for (const auto &item : data) {
+        const double u = item.longitude - meanLon, v = item.latitude - meanLat;
+        const double dx = item.x - meanX, dy = item.y - meanY;
+        normal(0, 0) += u * u;
+        normal(0, 1) += u * v;
+        normal(1, 1) += v * v;
+        rhs(0, 0) += u * dx;
+        rhs(1, 0) += v * dx;
+        rhs(0, 1) += u * dy;
+        rhs(1, 1) += v * dy;
     }
-    Eigen::Vector3d x = A.colPivHouseholderQr().solve(B_x); // 必须显示声明 Debug模式下Eigen有额外类型检查
-    Eigen::Vector3d y = A.colPivHouseholderQr().solve(B_y);
+    normal(1, 0) = normal(0, 1);
+    const Eigen::Matrix2d ab = normal.ldlt().solve(rhs);
+    Eigen::Vector3d x(ab(0, 0), ab(1, 0), 0);
+    Eigen::Vector3d y(ab(0, 1), ab(1, 1), 0);
+    x(2) = meanX - x(0) * meanLon - x(1) * meanLat;
+    y(2) = meanY - y(0) * meanLon - y(1) * meanLat;
     return {x, y};
 }
 
@@ -0,0 +1,16 @@
+#ifndef CHARTNAVIGATION_CONTROLPOINT_HPP
+#define CHARTNAVIGATION_CONTROLPOINT_HPP
+
+#include <type_traits>
+
+/**
+ * @brief 控制点(平凡类型,可整块拷贝与哈希)
+ */
+struct ControlPoint {
+    double latitude, longitude; // 纬度 经度
+    double x, y; // PDF坐标(点)
+};
+
+static_assert(std::is_trivially_copyable_v<ControlPoint> && (sizeof(ControlPoint) == 4 * sizeof(double)));
+
+#endif //CHARTNAVIGATION_CONTROLPOINT_HPP
@@ -0,0 +1,224 @@
+#include "controlPointExtractor.hpp"
+
+#include <QPdfDocument>
+#include <QPdfSelection>
+#include <QRegularExpression>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <tuple>
+
+#include "tools/threadPool.hpp"
+
+namespace
+{
+/**
+ * @brief 页面中带位置的一段文字
+ */
+struct TextRun {
+    QString text;
+    QRectF rect; // PDF坐标(点)
+};
+
+// 坐标: N29°45'07.5" / 29°45.1'N / N294507 / 1063911E 等
+const QRegularExpression coordinatePattern(
+    R"((?:[NSEW]\s?\d{1,3}°\s?\d{1,2}(?:\.\d+)?['′](?:\s?\d{1,2}(?:\.\d+)?["″])?)|)"
+    R"((?:\d{1,3}°\s?\d{1,2}(?:\.\d+)?['′](?:\s?\d{1,2}(?:\.\d+)?["″])?\s?[NSEW])|)"
+    R"((?:\b[NS]\d{4,6}(?:\.\d+)?\b)|(?:\b[EW]\d{5,7}(?:\.\d+)?\b)|)"
+    R"((?:\b\d{4,6}(?:\.\d+)?[NS]\b)|(?:\b\d{5,7}(?:\.\d+)?[EW]\b))");
+// 航路点标识: 五字代码 / 两字母三数字(如CK481)
+const QRegularExpression identPattern(R"(\b(?:[A-Z]{5}|[A-Z]{2}\d{3})\b)");
+// 常见的非航路点大写单词
+const QStringList identStopWords{"CHART", "NOTES", "SPEED", "ALTIT", "RADAR", "TOWER", "CLASS", "NOTAM", "ROUTE"};
+
+QPointF center (const QRectF &rect) {
+    return rect.center();
+}
+
+double distance (const QPointF &a, const QPointF &b) {
+    return std::hypot(a.x() - b.x(), a.y() - b.y());
+}
+
+/**
+ * @brief 在页面文字中查找全部匹配并取得位置
+ */
+std::vector<TextRun> findRuns (QPdfDocument &document, const int page, const QString &text,
+                               const QRegularExpression &pattern) {
+    std::vector<TextRun> runs;
+    auto it = pattern.globalMatch(text);
+    while (it.hasNext()) {
+        const auto match = it.next();
+        const QRectF rect = document.getSelectionAtIndex(page, static_cast<int>(match.capturedStart()),
+                                                         static_cast<int>(match.capturedLength())).boundingRectangle();
+        if (!rect.isEmpty())
+            runs.push_back({match.captured(), rect});
+    }
+    return runs;
+}
+}
+
+
+/**
+ * @brief 解析一个坐标字符串
+ * @param text 坐标文字,如 N29°45'07.5" 29°45.1'N N294507 1063911E
+ * @param isLatitude 输出: 是否为纬度
+ * @return 十进制度(南纬/西经为负),无法识别时为空
+ */
+std::optional<double> parseCoordinate (const QString &text, bool &isLatitude) {
+    QString body = text.trimmed();
+    if (body.isEmpty())
+        return std::nullopt;
+    // 半球
+    QChar hemisphere;
+    if (QString("NSEW").contains(body.front())) {
+        hemisphere = body.front();
+        body.remove(0, 1);
+    } else if (QString("NSEW").contains(body.back())) {
+        hemisphere = body.back();
+        body.chop(1);
+    } else
+        return std::nullopt;
+    isLatitude = (hemisphere == 'N') || (hemisphere == 'S');
+    const double sign = ((hemisphere == 'S') || (hemisphere == 'W')) ? -1 : 1;
+    double degree{}, minute{}, second{};
+    if (body.contains(u'°')) {
+        // 符号格式 度°分'秒"
+        static const QRegularExpression number(R"(\d+(?:\.\d+)?)");
+        std::vector<double> values;
+        auto it = number.globalMatch(body);
+        while (it.hasNext())
+            values.push_back(it.next().captured().toDouble());
+        if (values.size() < 2)
+            return std::nullopt;
+        degree = values[0];
+        minute = values[1];
+        second = values.size() > 2 ? values[2] : 0;
+    } else {
+        // 紧凑格式 纬度DD 经度DDD,之后为 MM(.m) 或 MMSS(.s)
+        const qsizetype dot = body.indexOf('.');
+        const QString integer = dot < 0 ? body : body.left(dot);
+        const QString fraction = dot < 0 ? QString() : body.mid(dot);
+        const int degreeDigits = isLatitude ? 2 : 3;
+        const qsizetype rest = integer.size() - degreeDigits;
+        if ((rest != 2) && (rest != 4))
+            return std::nullopt;
+        degree = integer.left(degreeDigits).toDouble();
+        if (rest == 2)
+            minute = (integer.mid(degreeDigits, 2) + fraction).toDouble();
+        else {
+            minute = integer.mid(degreeDigits, 2).toDouble();
+            second = (integer.mid(degreeDigits + 2, 2) + fraction).toDouble();
+        }
+    }
+    if ((minute >= 60) || (second >= 60))
+        return std::nullopt;
+    const double value = degree + minute / 60 + second / 3600;
+    if (value > (isLatitude ? 90 : 180)) // N90°30' 等超出范围
+        return std::nullopt;
+    return sign * value;
+}
+
+/**
+ * @brief 识别一页中的候选控制点
+ * @param document 已加载的文档
+ * @param page 页码(起始为0)
+ * @return 候选点
+ * @note 纬度与最近的同行右侧或下一行经度配对,再关联附近的航路点标识
+ */
+std::vector<ControlPointCandidate> extractPageControlPoints (QPdfDocument &document, const int page) {
+    const QString text = document.getAllText(page).text();
+    if (text.isEmpty())
+        return {};
+    // 坐标
+    std::vector<TextRun> latitudes, longitudes;
+    std::vector<double> latValues, lonValues;
+    for (auto &run : findRuns(document, page, text, coordinatePattern)) {
+        bool isLatitude{};
+        const auto value = parseCoordinate(run.text, isLatitude);
+        if (!value)
+            continue;
+        (isLatitude ? latValues : lonValues).push_back(*value);
+        (isLatitude ? latitudes : longitudes).push_back(std::move(run));
+    }
+    // 标识
+    std::vector<TextRun> idents;
+    for (auto &run : findRuns(document, page, text, identPattern))
+        if (!identStopWords.contains(run.text))
+            idents.push_back(std::move(run));
+    // 配对:按距离从小到大贪心,每个经度只用一次
+    struct Pair {
+        double cost;
+        size_t lat, lon;
+    };
+    std::vector<Pair> pairs;
+    for (size_t i = 0; i < latitudes.size(); ++i) {
+        const QRectF &a = latitudes[i].rect;
+        const double h = a.height();
+        for (size_t j = 0; j < longitudes.size(); ++j) {
+            const QRectF &b = longitudes[j].rect;
+            const bool sameLine = (std::abs(a.center().y() - b.center().y()) < h) && (b.left() >= a.left()) &&
+                                  (b.left() - a.right() < 6 * h);
+            const bool nextLine = (b.top() >= a.center().y()) && (b.top() - a.bottom() < 2 * h) &&
+                                  (std::abs(b.left() - a.left()) < 6 * h);
+            if (sameLine || nextLine)
+                pairs.push_back({distance(center(a), center(b)), i, j});
+        }
+    }
+    std::ranges::sort(pairs, [](const Pair &l, const Pair &r) {
+        return std::tie(l.cost, l.lat, l.lon) < std::tie(r.cost, r.lat, r.lon);
+    });
+    std::vector<bool> latUsed(latitudes.size()), lonUsed(longitudes.size());
+    std::vector<ControlPointCandidate> candidates;
+    for (const auto &[cost, i, j] : pairs) {
+        if (latUsed[i] || lonUsed[j])
+            continue;
+        latUsed[i] = lonUsed[j] = true;
+        const QRectF rect = latitudes[i].rect.united(longitudes[j].rect);
+        // 关联最近的标识(坐标文字上方优先)
+        const TextRun *ident{nullptr};
+        double best = 6 * latitudes[i].rect.height();
+        for (const auto &run : idents) {
+            double d = distance(center(run.rect), center(rect));
+            if (run.rect.bottom() > rect.top())
+                d *= 1.5;
+            if (d < best) {
+                best = d;
+                ident = &run;
+            }
+        }
+        const QPointF anchor = ident ? center(ident->rect) : center(rect);
+        candidates.push_back({page, latValues[i], lonValues[j], anchor.x(), anchor.y(), ident ? ident->text : QString()});
+    }
+    std::ranges::sort(candidates, [](const auto &l, const auto &r) { return std::tie(l.y, l.x) < std::tie(r.y, r.x); });
+    return candidates;
+}
+
+/**
+ * @brief 识别整个PDF的候选控制点,页面分块并行
+ * @param pdfPath PDF路径
+ * @param threads 线程数(0为全部核心)
+ * @return 候选点,按页码排序
+ * @note pdfium 内部有全局锁,文字读取仍是串行的,并行的是识别与配对;每个线程打开自己的文档对象
+ */
+std::vector<ControlPointCandidate> extractControlPoints (const QString &pdfPath, const size_t threads) {
+    int pageCount;
+    {
+        QPdfDocument document;
+        if (document.load(pdfPath) != QPdfDocument::Error::None)
+            return {};
+        pageCount = document.pageCount();
+    }
+    std::vector<std::vector<ControlPointCandidate>> pages(pageCount);
+    parallelFor(pageCount, threads, [&](const size_t begin, const size_t end, size_t) {
+        QPdfDocument document;
+        if (document.load(pdfPath) != QPdfDocument::Error::None)
+            return;
+        for (size_t page = begin; page < end; ++page)
+            pages[page] = extractPageControlPoints(document, static_cast<int>(page));
+    });
+    std::vector<ControlPointCandidate> result;
+    for (auto &page : pages)
+        std::ranges::move(page, std::back_inserter(result));
+    return result;
+}
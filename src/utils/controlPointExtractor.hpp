@@ -0,0 +1,24 @@
+#ifndef CHARTNAVIGATION_CONTROLPOINTEXTRACTOR_HPP
+#define CHARTNAVIGATION_CONTROLPOINTEXTRACTOR_HPP
+
+#include <QString>
+#include <optional>
+#include <vector>
+
+class QPdfDocument;
+
+/**
+ * @brief 从文字层识别出的候选控制点
+ */
+struct ControlPointCandidate {
+    int page; // 页码(起始为0)
+    double latitude, longitude;
+    double x, y; // PDF坐标(点),取航路点标识中心,没有标识时取坐标文字中心
+    QString ident; // 航路点标识(可能为空)
+};
+
+std::optional<double> parseCoordinate (const QString &text, bool &isLatitude);
+std::vector<ControlPointCandidate> extractPageControlPoints (QPdfDocument &document, int page);
+std::vector<ControlPointCandidate> extractControlPoints (const QString &pdfPath, size_t threads = 0);
+
+#endif //CHARTNAVIGATION_CONTROLPOINTEXTRACTOR_HPP
@@ -0,0 +1,78 @@
+#include "incrementalAffine.hpp"
+
+/**
+ * @brief 加入一个点(秩1更新)
+ */
+void IncrementalAffine::add (const double latitude, const double longitude, const double x, const double y) {
+    if (!hasOrigin) {
+        lat0 = latitude;
+        lon0 = longitude;
+        x0 = x;
+        y0 = y;
+        hasOrigin = true;
+    }
+    accumulate(latitude, longitude, x, y, 1);
+    ++count;
+}
+
+/**
+ * @brief 移除一个之前加入的点(秩1回退)
+ */
+void IncrementalAffine::remove (const double latitude, const double longitude, const double x, const double y) {
+    if (count == 0)
+        return;
+    accumulate(latitude, longitude, x, y, -1);
+    if (--count == 0)
+        clear();
+}
+
+/**
+ * @brief 求解当前点集的最小二乘参数
+ * @param paramsX x参数
+ * @param paramsY y参数
+ * @return 是否可解(至少3个不共线点)
+ */
+bool IncrementalAffine::solve (Eigen::Vector3d &paramsX, Eigen::Vector3d &paramsY) const {
+    if (count < 3)
+        return false;
+    // 去均值后的2x2法方程
+    const double mu = su / n, mv = sv / n, mx = sx / n, my = sy / n;
+    Eigen::Matrix2d normal;
+    normal << suu - su * mu, suv - su * mv,
+            suv - su * mv, svv - sv * mv;
+    Eigen::Matrix2d rhs;
+    rhs << sux - su * mx, suy - su * my,
+            svx - sv * mx, svy - sv * my;
+    const double det = normal.determinant();
+    if (std::abs(det) <= 1e-12 * normal.squaredNorm())
+        return false;
+    const Eigen::Matrix2d ab = normal.inverse() * rhs;
+    // 还原到绝对坐标
+    paramsX << ab(0, 0), ab(1, 0), 0;
+    paramsY << ab(0, 1), ab(1, 1), 0;
+    paramsX(2) = x0 + mx - ab(0, 0) * (lon0 + mu) - ab(1, 0) * (lat0 + mv);
+    paramsY(2) = y0 + my - ab(0, 1) * (lon0 + mu) - ab(1, 1) * (lat0 + mv);
+    return true;
+}
+
+void IncrementalAffine::clear () {
+    *this = IncrementalAffine{};
+}
+
+void IncrementalAffine::accumulate (const double latitude, const double longitude, const double x, const double y,
+                                    const double weight) {
+    const double u = longitude - lon0, v = latitude - lat0;
+    const double dx = x - x0, dy = y - y0;
+    n += weight;
+    su += weight * u;
+    sv += weight * v;
+    suu += weight * u * u;
+    suv += weight * u * v;
+    svv += weight * v * v;
+    sx += weight * dx;
+    sux += weight * u * dx;
+    svx += weight * v * dx;
+    sy += weight * dy;
+    suy += weight * u * dy;
+    svy += weight * v * dy;
+}
@@ -0,0 +1,27 @@
+#ifndef CHARTNAVIGATION_INCREMENTALAFFINE_HPP
+#define CHARTNAVIGATION_INCREMENTALAFFINE_HPP
+
+#include <Eigen/Dense>
+
+/**
+ * 增量最小二乘仿射:只保存法方程累加量,增删一个点为秩1更新/回退,求解为常数时间
+ * 坐标相对固定原点(第一个加入的点)累加,避免经纬度数量级导致的抵消
+ */
+class IncrementalAffine {
+    public:
+        void add (double latitude, double longitude, double x, double y);
+        void remove (double latitude, double longitude, double x, double y);
+        bool solve (Eigen::Vector3d &paramsX, Eigen::Vector3d &paramsY) const;
+        void clear ();
+        [[nodiscard]] size_t size () const { return count; }
+    private:
+        void accumulate (double latitude, double longitude, double x, double y, double weight);
+
+        bool hasOrigin{false};
+        double lon0{}, lat0{}, x0{}, y0{}; // 原点
+        size_t count{0};
+        double n{}, su{}, sv{}, suu{}, suv{}, svv{}; // 设计矩阵累加量 (u=经度 v=纬度)
+        double sx{}, sux{}, svx{}, sy{}, suy{}, svy{}; // 右端累加量
+};
+
+#endif //CHARTNAVIGATION_INCREMENTALAFFINE_HPP
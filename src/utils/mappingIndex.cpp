@@ -0,0 +1,160 @@
+#include "mappingIndex.hpp"
+
+#include <algorithm>
+#include <boost/asio/post.hpp>
+
+#include "tbinFile.hpp"
+#include "tools/threadPool.hpp"
+
+MappingIndex::~MappingIndex () {
+    stop();
+}
+
+/**
+ * @brief 开始索引一个映射文件夹(停止上一个文件夹的索引)
+ * @param folder 映射文件夹
+ * @param onPublish 每次发布新快照后调用(在工作线程中)
+ */
+void MappingIndex::start (const std::filesystem::path &folder, const std::function<void()> &onPublish) {
+    stop();
+    job = std::make_shared<Job>();
+    job->folder = folder;
+    job->onPublish = onPublish;
+    job->target = &current;
+    schedule(job);
+}
+
+/**
+ * @brief 请求增量更新(文件变化时调用),扫描进行中时合并为一次补扫
+ */
+void MappingIndex::refresh () {
+    if (job)
+        schedule(job);
+}
+
+/**
+ * @brief 停止索引并清空快照,返回后不会再发布或回调
+ */
+void MappingIndex::stop () {
+    if (job) {
+        const std::lock_guard lock(job->mutex);
+        job->cancelled = true;
+    }
+    job.reset();
+    current.store(nullptr);
+}
+
+/**
+ * @brief 首次扫描是否已完成
+ */
+bool MappingIndex::ready () const {
+    return current.load() != nullptr;
+}
+
+/**
+ * @brief 查找一份航图的映射(只读快照,不会被扫描阻塞)
+ * @param chartName 航图名(映射文件中的键)
+ * @return 不存在或尚未扫描完成时为空;文件未变化时多次查询返回同一对象
+ */
+std::shared_ptr<const ChartMapping> MappingIndex::find (const std::string &chartName) const {
+    const auto snapshot = current.load();
+    if (!snapshot)
+        return nullptr;
+    const auto it = snapshot->charts.find(chartName);
+    return it == snapshot->charts.end() ? nullptr : it->second;
+}
+
+/**
+ * @brief 已索引的映射文件(供文件监视使用)
+ */
+std::vector<std::filesystem::path> MappingIndex::files () const {
+    std::vector<std::filesystem::path> paths;
+    if (const auto snapshot = current.load())
+        for (const auto &file : snapshot->files)
+            paths.push_back(file.path);
+    return paths;
+}
+
+void MappingIndex::schedule (const std::shared_ptr<Job> &job) {
+    {
+        const std::lock_guard lock(job->mutex);
+        if (job->cancelled)
+            return;
+        if (job->scanning) {
+            job->dirty = true;
+            return;
+        }
+        job->scanning = true;
+    }
+    boost::asio::post(sharedPool(), [job] { scan(job); });
+}
+
+/**
+ * @brief 扫描文件夹,只重读大小或修改时间变化的文件,有变化时发布新快照
+ * @note 扫描期间到达的刷新请求在本次结束后补扫一次
+ */
+void MappingIndex::scan (const std::shared_ptr<Job> &job) {
+    while (true) {
+        {
+            const std::lock_guard lock(job->mutex);
+            if (job->cancelled)
+                return;
+            job->dirty = false;
+        }
+        std::vector<std::filesystem::path> paths;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(job->folder, ec), end; !ec && (it != end); it.increment(ec))
+            if (it->is_regular_file() && (it->path().extension() == ".Tmap"))
+                paths.push_back(it->path());
+        std::ranges::sort(paths);
+        const auto previous = job->target->load();
+        std::unordered_map<std::filesystem::path::string_type, const FileEntry *> known;
+        if (previous)
+            for (const auto &file : previous->files)
+                known.emplace(file.path.native(), &file);
+        auto next = std::make_shared<Snapshot>();
+        bool changed = !previous || (previous->files.size() != paths.size());
+        for (const auto &path : paths) {
+            FileEntry entry{path, std::filesystem::file_size(path, ec), {}, {}};
+            if (!ec)
+                entry.time = std::filesystem::last_write_time(path, ec);
+            if (ec)
+                continue; // 扫描期间被删除
+            if (const auto it = known.find(path.native());
+                (it != known.end()) && (it->second->size == entry.size) && (it->second->time == entry.time)) {
+                // 未变化,沿用
+                entry.charts = it->second->charts;
+                for (const auto &name : entry.charts)
+                    next->charts[name] = previous->charts.at(name);
+            } else {
+                changed = true;
+                for (auto &[name, mapping] : readFile(path)) {
+                    entry.charts.push_back(name);
+                    next->charts[name] = std::make_shared<const ChartMapping>(std::move(mapping));
+                }
+            }
+            next->files.push_back(std::move(entry));
+        }
+        const std::lock_guard lock(job->mutex);
+        if (job->cancelled)
+            return;
+        if (changed) {
+            job->target->store(std::move(next));
+            if (job->onPublish)
+                job->onPublish();
+        }
+        if (!job->dirty) {
+            job->scanning = false;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 读取一个映射文件的全部航图,同名 .Tbin 未过期时直接使用(含拟合结果)
+ */
+std::map<std::string, ChartMapping> MappingIndex::readFile (const std::filesystem::path &tmapPath) {
+    if (TbinFile tbin; tbin.open(std::filesystem::path(tmapPath).replace_extension(".Tbin"), tmapPath))
+        return tbin.charts();
+    return readTmap(tmapPath);
+}
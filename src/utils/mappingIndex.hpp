@@ -0,0 +1,62 @@
+#ifndef CHARTNAVIGATION_MAPPINGINDEX_HPP
+#define CHARTNAVIGATION_MAPPINGINDEX_HPP
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pageMapping.hpp"
+
+/**
+ * 映射文件夹的全局内存索引(航图名 -> 页面映射)
+ * 启动时在线程池中扫描一次;之后按文件大小/修改时间增量更新,未变化的文件沿用上一份结果
+ * 每次扫描发布一份只读快照,查询只取快照指针,不会被扫描或发布阻塞,也不会看到半成品
+ */
+class MappingIndex {
+    public:
+        MappingIndex () = default;
+        ~MappingIndex ();
+        MappingIndex (const MappingIndex &) = delete;
+        MappingIndex& operator= (const MappingIndex &) = delete;
+
+        void start (const std::filesystem::path &folder, const std::function<void()> &onPublish);
+        void refresh ();
+        void stop ();
+        [[nodiscard]] bool ready () const;
+        [[nodiscard]] std::shared_ptr<const ChartMapping> find (const std::string &chartName) const;
+        [[nodiscard]] std::vector<std::filesystem::path> files () const;
+    private:
+        struct FileEntry {
+            std::filesystem::path path;
+            uintmax_t size;
+            std::filesystem::file_time_type time;
+            std::vector<std::string> charts; // 该文件提供的航图
+        };
+        struct Snapshot {
+            std::vector<FileEntry> files; // 按路径排序
+            std::unordered_map<std::string, std::shared_ptr<const ChartMapping>> charts;
+        };
+        struct Job {
+            std::mutex mutex;
+            bool cancelled{false};
+            bool scanning{false}; // 已有扫描在进行
+            bool dirty{false}; // 扫描期间又收到刷新请求
+            std::filesystem::path folder;
+            std::function<void()> onPublish;
+            std::atomic<std::shared_ptr<const Snapshot>> *target;
+        };
+
+        std::atomic<std::shared_ptr<const Snapshot>> current;
+        std::shared_ptr<Job> job;
+
+        static void schedule (const std::shared_ptr<Job> &job);
+        static void scan (const std::shared_ptr<Job> &job);
+        static std::map<std::string, ChartMapping> readFile (const std::filesystem::path &tmapPath);
+};
+
+#endif //CHARTNAVIGATION_MAPPINGINDEX_HPP
@@ -0,0 +1,356 @@
+#include "pageMapping.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "json.hpp"
+#include "tbinFile.hpp"
+#include "transformCache.hpp"
+#include "tools/threadPool.hpp"
+
+using namespace nlohmann;
+
+namespace
+{
+/**
+ * SAX方式解析映射文件,不建立DOM
+ * 结构: {航图名: [[{页头}, [纬度,经度,x,y,标识], ...], ...], ...}
+ * 指定航图时其余顶层键只做词法扫描不保存,目标航图结束后立即停止
+ */
+class TmapHandler {
+    public:
+        explicit TmapHandler (const std::string *filter) : filter(filter) {}
+
+        std::map<std::string, ChartMapping> charts;
+        bool finished{false}; // 目标航图已读完(主动停止解析)
+
+        bool null () { return true; }
+        bool boolean (bool) { return true; }
+        bool number_integer (const json::number_integer_t value) { return number(static_cast<double>(value)); }
+        bool number_unsigned (const json::number_unsigned_t value) { return number(static_cast<double>(value)); }
+        bool number_float (const json::number_float_t value, const json::string_t &) { return number(value); }
+        bool binary (json::binary_t &) { return true; }
+
+        bool string (json::string_t &value) {
+            if (!capture || (depth != 4) || !inHeader)
+                return true;
+            if (headerKey == "type") {
+                page->type = value == "parking" ? PageType::Parking : PageType::Terminal;
+                page->threshold = pageThreshold(page->type);
+            }
+            else if (headerKey == "model")
+                page->model = value == "piecewise" ? TransformModel::Piecewise : TransformModel::Affine;
+            return true;
+        }
+
+        bool key (json::string_t &value) {
+            if (depth == 1) {
+                capture = (filter == nullptr) || (value == *filter);
+                if (capture)
+                    chart = &charts[value];
+            } else if (capture && (depth == 4))
+                headerKey = value;
+            return true;
+        }
+
+        bool start_object (std::size_t) {
+            ++depth;
+            if (capture && (depth == 4))
+                inHeader = true;
+            return true;
+        }
+
+        bool end_object () {
+            if (capture && (depth == 4))
+                inHeader = false;
+            --depth;
+            return true;
+        }
+
+        bool start_array (std::size_t) {
+            ++depth;
+            if (!capture)
+                return true;
+            if (depth == 3) { // 一页
+                page = std::make_shared<PageMapping>();
+                page->type = PageType::Terminal;
+                page->threshold = pageThreshold(page->type);
+                page->model = TransformModel::Affine;
+            } else if (depth == 4) { // 一个控制点
+                point = {};
+                index = 0;
+            }
+            return true;
+        }
+
+        bool end_array () {
+            if (capture) {
+                if (depth == 4)
+                    page->data.push_back(point);
+                else if (depth == 3)
+                    placePage(*chart, std::move(page));
+                else if ((depth == 2) && filter) { // 目标航图结束
+                    finished = true;
+                    return false;
+                }
+            }
+            --depth;
+            return true;
+        }
+
+        bool parse_error (std::size_t, const std::string &, const detail::exception &) {
+            return false;
+        }
+    private:
+        const std::string *filter;
+        int depth{0};
+        bool capture{false};
+        bool inHeader{false};
+        std::string headerKey; // 页头中当前的键
+        ChartMapping *chart{nullptr};
+        std::shared_ptr<PageMapping> page;
+        ControlPoint point{};
+        int index{0};
+
+        bool number (const double value) {
+            if (!capture || (depth != 4))
+                return true;
+            if (inHeader) {
+                if (headerKey == "page")
+                    page->page = static_cast<int>(value);
+                else if (headerKey == "rotate")
+                    page->rotate = value;
+                return true;
+            }
+            switch (index++) {
+                case 0: point.latitude = value;
+                    break;
+                case 1: point.longitude = value;
+                    break;
+                case 2: point.x = value;
+                    break;
+                case 3: point.y = value;
+                    break;
+                default: break;
+            }
+            return true;
+        }
+};
+
+/**
+ * @brief 内存映射文件并以SAX方式解析
+ * @param filter 只读取的航图名(为空则读取全部)
+ * @return 解析是否成功
+ */
+bool parseMapped (const std::filesystem::path &tmapPath, TmapHandler &handler) {
+    try {
+        const boost::interprocess::file_mapping file(tmapPath.c_str(), boost::interprocess::read_only);
+        const boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+        const auto *begin = static_cast<const char *>(region.get_address());
+        const bool ok = json::sax_parse(begin, begin + region.get_size(), &handler);
+        return ok || handler.finished;
+    } catch (const boost::interprocess::interprocess_exception &) {
+        return false; // 不存在或为空
+    }
+}
+}
+
+
+/**
+ * @brief 按页码放入映射表(表按需加长)
+ * @return 是否放入;页码越界或该页已有映射(同一页重复时以先出现的为准)时为否
+ */
+bool placePage (ChartMapping &mapping, std::shared_ptr<const PageMapping> pageMapping) {
+    const int pageNum = pageMapping->page;
+    if ((pageNum < 0) || (pageNum >= MAX_PAGE_COUNT))
+        return false;
+    if (mapping.size() <= static_cast<size_t>(pageNum))
+        mapping.resize(pageNum + 1);
+    if (mapping[pageNum])
+        return false;
+    mapping[pageNum] = std::move(pageMapping);
+    return true;
+}
+
+/**
+ * @brief 查找一页
+ * @param pageNum 页码(起始为0)
+ * @return 不存在时为空
+ */
+std::shared_ptr<const PageMapping> findPage (const ChartMapping &mapping, const int pageNum) {
+    if ((pageNum < 0) || (static_cast<size_t>(pageNum) >= mapping.size()))
+        return nullptr;
+    return mapping[pageNum];
+}
+
+/**
+ * @brief 解析映射文件(一个机场)
+ * @param tmapPath 映射文件路径
+ * @return 航图名 -> 各页映射,文件不可用时为空
+ */
+std::map<std::string, ChartMapping> readTmap (const std::filesystem::path &tmapPath) {
+    TmapHandler handler(nullptr);
+    if (!parseMapped(tmapPath, handler))
+        return {};
+    return std::move(handler.charts);
+}
+
+/**
+ * @brief 只解析映射文件中的一份航图
+ * @param tmapPath 映射文件路径
+ * @param chartName 航图名
+ * @return 各页映射,文件不可用或没有该航图时为空
+ * @note 其他航图只扫描不保存,读完目标航图即停止
+ */
+std::optional<ChartMapping> readTmapChart (const std::filesystem::path &tmapPath, const std::string &chartName) {
+    TmapHandler handler(&chartName);
+    if (!parseMapped(tmapPath, handler))
+        return std::nullopt;
+    const auto it = handler.charts.find(chartName);
+    if (it == handler.charts.end())
+        return std::nullopt;
+    return std::move(it->second);
+}
+
+
+/**
+ * @param cacheDirectory 拟合结果缓存目录(为空则不使用磁盘缓存)
+ */
+MappingPrecomputer::MappingPrecomputer (std::string cacheDirectory) : cacheDirectory(std::move(cacheDirectory)) {}
+
+MappingPrecomputer::~MappingPrecomputer () {
+    cancel();
+}
+
+/**
+ * @brief 开始后台解析与拟合(取消上一个任务)
+ * @param tmapPath 映射文件路径
+ * @param chartName 航图名(映射文件中的键)
+ * @param onPublish 每次发布新快照后调用(在工作线程中)
+ */
+void MappingPrecomputer::start (const std::filesystem::path &tmapPath, const std::string &chartName,
+                                const std::function<void()> &onPublish) {
+    cancel();
+    job = std::make_shared<Job>();
+    job->onPublish = onPublish;
+    job->target = &current;
+    job->cacheDirectory = cacheDirectory;
+    boost::asio::post(sharedPool(), [job = job, tmapPath, chartName] { parse(job, tmapPath, chartName); });
+}
+
+/**
+ * @brief 开始拟合已解析好的航图(来自映射索引,取消上一个任务)
+ * @param chart 各页映射,已有拟合结果的页面直接使用
+ * @param onPublish 每次发布新快照后调用(在工作线程中)
+ */
+void MappingPrecomputer::start (const std::shared_ptr<const ChartMapping> &chart,
+                                const std::function<void()> &onPublish) {
+    cancel();
+    job = std::make_shared<Job>();
+    job->onPublish = onPublish;
+    job->target = &current;
+    job->cacheDirectory = cacheDirectory;
+    if (chart)
+        dispatch(job, *chart);
+}
+
+/**
+ * @brief 取消当前任务并清空快照,返回后任务不会再发布或回调
+ */
+void MappingPrecomputer::cancel () {
+    if (job) {
+        const std::lock_guard lock(job->mutex);
+        job->cancelled = true;
+    }
+    job.reset();
+    current.store(nullptr);
+}
+
+/**
+ * @brief 当前快照(尚未解析完成时为空)
+ */
+std::shared_ptr<const ChartMapping> MappingPrecomputer::mapping () const {
+    return current.load();
+}
+
+/**
+ * @brief 查找一页的映射
+ * @param pageNum 页码(起始为0)
+ * @return 不存在时为空
+ */
+std::shared_ptr<const PageMapping> MappingPrecomputer::page (const int pageNum) const {
+    const auto snapshot = current.load();
+    return snapshot ? findPage(*snapshot, pageNum) : nullptr;
+}
+
+/**
+ * @brief 解析映射文件后派发
+ * @note 同名 .Tbin 存在且未过期时直接使用其中已拟合的页面,不解析也不拟合
+ */
+void MappingPrecomputer::parse (const std::shared_ptr<Job> &job, const std::filesystem::path &tmapPath,
+                                const std::string &chartName) {
+    if (TbinFile tbin; tbin.open(std::filesystem::path(tmapPath).replace_extension(".Tbin"), tmapPath)) {
+        if (const auto compiled = tbin.chart(chartName)) {
+            dispatch(job, *compiled);
+            return;
+        }
+    }
+    if (const auto chart = readTmapChart(tmapPath, chartName))
+        dispatch(job, *chart);
+}
+
+/**
+ * @brief 发布页面表,再为尚未拟合的页面派发拟合任务
+ */
+void MappingPrecomputer::dispatch (const std::shared_ptr<Job> &job, const ChartMapping &pages) {
+    publish(job, [&](ChartMapping &mapping) { mapping = pages; });
+    for (size_t i = 0; i < pages.size(); ++i)
+        if (pages[i] && !pages[i]->fit)
+            boost::asio::post(sharedPool(), [job, pageMapping = pages[i], i] {
+                fitPage(job, pageMapping, i);
+            });
+}
+
+/**
+ * @brief 拟合一页(优先读磁盘缓存)并发布
+ * @note 页面之间已经并行,单页RANSAC不再拆分线程
+ */
+void MappingPrecomputer::fitPage (const std::shared_ptr<Job> &job, const std::shared_ptr<const PageMapping> &pageMapping,
+                                  const size_t index) {
+    {
+        const std::lock_guard lock(job->mutex);
+        if (job->cancelled)
+            return;
+    }
+    TransformCache cache(job->cacheDirectory);
+    const uint64_t key = TransformCache::key(pageMapping->data, pageMapping->threshold);
+    AffineFit fit;
+    if (!cache.load(key, pageMapping->data.size(), fit)) {
+        AffineTransformer transformer;
+        RansacOptions options;
+        options.threads = 1;
+        if (!transformer.loadData(pageMapping->data, pageMapping->threshold, options))
+            return;
+        fit = transformer.result();
+        cache.store(key, pageMapping->data.size(), fit);
+    }
+    auto fitted = std::make_shared<PageMapping>(*pageMapping);
+    fitted->fit = std::move(fit);
+    publish(job, [&](ChartMapping &mapping) { mapping[index] = std::move(fitted); });
+}
+
+/**
+ * @brief 在当前快照的副本上修改后整体替换
+ */
+void MappingPrecomputer::publish (const std::shared_ptr<Job> &job, const std::function<void(ChartMapping &)> &modify) {
+    const std::lock_guard lock(job->mutex);
+    if (job->cancelled)
+        return;
+    const auto previous = job->target->load();
+    auto next = previous ? std::make_shared<ChartMapping>(*previous) : std::make_shared<ChartMapping>();
+    modify(*next);
+    job->target->store(std::move(next));
+    if (job->onPublish)
+        job->onPublish();
+}
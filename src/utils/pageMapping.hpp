@@ -0,0 +1,93 @@
+#ifndef CHARTNAVIGATION_PAGEMAPPING_HPP
+#define CHARTNAVIGATION_PAGEMAPPING_HPP
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "affineTransformer.hpp"
+#include "piecewiseAffine.hpp"
+
+/**
+ * @brief 页面类型(决定筛选阈值)
+ */
+enum class PageType {
+    Terminal, // 终端区
+    Parking, // 机场图
+};
+
+constexpr double pageThreshold (const PageType type) {
+    return type == PageType::Parking ? 10.0 : 5.0;
+}
+
+/**
+ * @brief 一页的映射数据
+ */
+struct PageMapping {
+    int page; // 页码(起始为0)
+    std::vector<ControlPoint> data; // 控制点(连续存储)
+    PageType type; // 页面类型
+    double rotate; // 机模旋转角度
+    double threshold; // 筛选阈值
+    TransformModel model; // 映射模型
+    std::optional<AffineFit> fit; // 拟合结果(后台完成后才有)
+};
+
+/**
+ * 一份航图的映射表,按页码直接索引(无映射的页为空),换页为常数时间
+ */
+using ChartMapping = std::vector<std::shared_ptr<const PageMapping>>;
+
+constexpr int MAX_PAGE_COUNT{4096}; // 单份航图页数上限,页码超出的页面忽略
+
+bool placePage (ChartMapping &mapping, std::shared_ptr<const PageMapping> pageMapping);
+std::shared_ptr<const PageMapping> findPage (const ChartMapping &mapping, int pageNum);
+
+std::map<std::string, ChartMapping> readTmap (const std::filesystem::path &tmapPath);
+std::optional<ChartMapping> readTmapChart (const std::filesystem::path &tmapPath, const std::string &chartName);
+
+/**
+ * 打开航图时在线程池中解析映射文件(或直接取索引中的页面)并拟合尚未拟合的页面
+ * 每完成一页发布一份新的只读快照(写时复制),读取方不会被解析或拟合阻塞,也不会看到半成品
+ */
+class MappingPrecomputer {
+    public:
+        explicit MappingPrecomputer (std::string cacheDirectory = {});
+        ~MappingPrecomputer ();
+        MappingPrecomputer (const MappingPrecomputer &) = delete;
+        MappingPrecomputer& operator= (const MappingPrecomputer &) = delete;
+
+        void start (const std::filesystem::path &tmapPath, const std::string &chartName,
+                    const std::function<void()> &onPublish);
+        void start (const std::shared_ptr<const ChartMapping> &chart, const std::function<void()> &onPublish);
+        void cancel ();
+        [[nodiscard]] std::shared_ptr<const ChartMapping> mapping () const;
+        [[nodiscard]] std::shared_ptr<const PageMapping> page (int pageNum) const;
+    private:
+        struct Job {
+            std::mutex mutex; // 串行化发布
+            bool cancelled{false};
+            std::function<void()> onPublish;
+            std::atomic<std::shared_ptr<const ChartMapping>> *target;
+            std::string cacheDirectory;
+        };
+
+        std::atomic<std::shared_ptr<const ChartMapping>> current;
+        std::shared_ptr<Job> job;
+        std::string cacheDirectory;
+
+        static void parse (const std::shared_ptr<Job> &job, const std::filesystem::path &tmapPath,
+                           const std::string &chartName);
+        static void dispatch (const std::shared_ptr<Job> &job, const ChartMapping &pages);
+        static void fitPage (const std::shared_ptr<Job> &job, const std::shared_ptr<const PageMapping> &pageMapping,
+                             size_t index);
+        static void publish (const std::shared_ptr<Job> &job, const std::function<void(ChartMapping &)> &modify);
+};
+
+#endif //CHARTNAVIGATION_PAGEMAPPING_HPP
@@ -0,0 +1,219 @@
+#include "piecewiseAffine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+#include "simdKernel.hpp"
+
+namespace
+{
+struct Vertex {
+    double u, v; // 剖分坐标(经度按纬度余弦缩放,使外接圆判断接近等距)
+};
+
+struct Face {
+    int a, b, c;
+    double cu, cv, r2; // 外接圆
+};
+
+Face makeFace (const std::vector<Vertex> &vertices, const int a, const int b, const int c) {
+    const Vertex &p = vertices[a], &q = vertices[b], &r = vertices[c];
+    const double d = 2 * (p.u * (q.v - r.v) + q.u * (r.v - p.v) + r.u * (p.v - q.v));
+    const double p2 = p.u * p.u + p.v * p.v, q2 = q.u * q.u + q.v * q.v, r2 = r.u * r.u + r.v * r.v;
+    const double cu = (p2 * (q.v - r.v) + q2 * (r.v - p.v) + r2 * (p.v - q.v)) / d;
+    const double cv = (p2 * (r.u - q.u) + q2 * (p.u - r.u) + r2 * (q.u - p.u)) / d;
+    return {a, b, c, cu, cv, (p.u - cu) * (p.u - cu) + (p.v - cv) * (p.v - cv)};
+}
+
+/**
+ * @brief Bowyer-Watson 增量Delaunay剖分
+ * @return 三角形顶点索引
+ * @note 控制点通常不超过几十个,O(n²)足够
+ */
+std::vector<std::array<int, 3>> triangulate (std::vector<Vertex> vertices) {
+    const int n = static_cast<int>(vertices.size());
+    double minU{vertices[0].u}, maxU{minU}, minV{vertices[0].v}, maxV{minV};
+    for (const auto &[u, v] : vertices) {
+        minU = std::min(minU, u);
+        maxU = std::max(maxU, u);
+        minV = std::min(minV, v);
+        maxV = std::max(maxV, v);
+    }
+    // 超级三角形
+    const double span = std::max(maxU - minU, maxV - minV) * 20 + 1;
+    const double midU = (minU + maxU) / 2, midV = (minV + maxV) / 2;
+    vertices.push_back({midU - span, midV - span});
+    vertices.push_back({midU + span, midV - span});
+    vertices.push_back({midU, midV + span});
+    std::vector<Face> faces{makeFace(vertices, n, n + 1, n + 2)};
+    std::vector<std::array<int, 2>> edges;
+    for (int i = 0; i < n; ++i) {
+        const Vertex &p = vertices[i];
+        edges.clear();
+        // 外接圆包含新点的三角形被移除,其边界边与新点相连
+        std::erase_if(faces, [&](const Face &face) {
+            if ((p.u - face.cu) * (p.u - face.cu) + (p.v - face.cv) * (p.v - face.cv) > face.r2)
+                return false;
+            edges.push_back({face.a, face.b});
+            edges.push_back({face.b, face.c});
+            edges.push_back({face.c, face.a});
+            return true;
+        });
+        for (size_t e = 0; e < edges.size(); ++e) {
+            const auto [a, b] = edges[e];
+            const bool shared = std::ranges::any_of(edges, [&](const auto &other) {
+                return (other[0] == b) && (other[1] == a);
+            });
+            if (!shared)
+                faces.push_back(makeFace(vertices, a, b, i));
+        }
+    }
+    std::vector<std::array<int, 3>> result;
+    for (const auto &face : faces)
+        if ((face.a < n) && (face.b < n) && (face.c < n))
+            result.push_back({face.a, face.b, face.c});
+    return result;
+}
+}
+
+
+/**
+ * @brief 由内点构建分片模型
+ * @param points 全部控制点
+ * @param inlierMask 内点位掩码
+ * @param paramsX 全局仿射x参数(凸包外使用)
+ * @param paramsY 全局仿射y参数
+ * @return 是否得到至少一个三角形
+ */
+bool PiecewiseAffine::build (const std::span<const ControlPoint> points, const std::vector<uint64_t> &inlierMask,
+                             const Eigen::Vector3d &paramsX, const Eigen::Vector3d &paramsY) {
+    clear();
+    global = {paramsX(0), paramsX(1), paramsX(2), paramsY(0), paramsY(1), paramsY(2)};
+    // 内点(去掉重合点)
+    std::vector<ControlPoint> inliers;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (!testBit(inlierMask, i))
+            continue;
+        const ControlPoint &p = points[i];
+        const bool duplicate = std::ranges::any_of(inliers, [&](const ControlPoint &q) {
+            return (std::abs(p.latitude - q.latitude) < 1e-9) && (std::abs(p.longitude - q.longitude) < 1e-9);
+        });
+        if (!duplicate)
+            inliers.push_back(p);
+    }
+    if (inliers.size() < 3)
+        return false;
+    double meanLat{0};
+    for (const auto &p : inliers)
+        meanLat += p.latitude;
+    const double lonScale = std::cos(meanLat / static_cast<double>(inliers.size()) * std::numbers::pi / 180);
+    std::vector<Vertex> vertices;
+    vertices.reserve(inliers.size() + 3);
+    for (const auto &p : inliers)
+        vertices.push_back({p.longitude * lonScale, p.latitude});
+    // 每个三角形的精确仿射(共享边上连续)
+    minLon = minLat = std::numeric_limits<double>::infinity();
+    double maxLon{-minLon}, maxLat{-minLat};
+    for (const auto &[ia, ib, ic] : triangulate(std::move(vertices))) {
+        const ControlPoint &a = inliers[ia], &b = inliers[ib], &c = inliers[ic];
+        Triangle t{a.longitude, a.latitude, b.longitude - a.longitude, b.latitude - a.latitude,
+                   c.longitude - a.longitude, c.latitude - a.latitude, 0, {}};
+        const double det = t.e1u * t.e2v - t.e2u * t.e1v;
+        if (std::abs(det) <= 1e-9 * (t.e1u * t.e1u + t.e1v * t.e1v + t.e2u * t.e2u + t.e2v * t.e2v))
+            continue; // 退化
+        t.invDet = 1 / det;
+        const auto solve = [&](const double va, const double vb, const double vc, double *out) {
+            const double d1 = vb - va, d2 = vc - va;
+            out[0] = (t.e2v * d1 - t.e1v * d2) * t.invDet;
+            out[1] = (t.e1u * d2 - t.e2u * d1) * t.invDet;
+            out[2] = va - out[0] * a.longitude - out[1] * a.latitude;
+        };
+        solve(a.x, b.x, c.x, t.params.data());
+        solve(a.y, b.y, c.y, t.params.data() + 3);
+        for (const ControlPoint *p : {&a, &b, &c}) {
+            minLon = std::min(minLon, p->longitude);
+            maxLon = std::max(maxLon, p->longitude);
+            minLat = std::min(minLat, p->latitude);
+            maxLat = std::max(maxLat, p->latitude);
+        }
+        triangles.push_back(t);
+    }
+    if (triangles.empty())
+        return false;
+    // 网格:格子数与三角形数相当,每格平均只需测试少数几个三角形
+    cols = rows = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(triangles.size())))));
+    invCellLon = cols / std::max(maxLon - minLon, 1e-12);
+    invCellLat = rows / std::max(maxLat - minLat, 1e-12);
+    const auto cellRange = [&](const Triangle &t) {
+        const double lons[3]{t.lon0, t.lon0 + t.e1u, t.lon0 + t.e2u};
+        const double lats[3]{t.lat0, t.lat0 + t.e1v, t.lat0 + t.e2v};
+        const auto clampCol = [&](const double lon) {
+            return std::clamp(static_cast<int>((lon - minLon) * invCellLon), 0, cols - 1);
+        };
+        const auto clampRow = [&](const double lat) {
+            return std::clamp(static_cast<int>((lat - minLat) * invCellLat), 0, rows - 1);
+        };
+        return std::array{clampCol(*std::ranges::min_element(lons)), clampCol(*std::ranges::max_element(lons)),
+                          clampRow(*std::ranges::min_element(lats)), clampRow(*std::ranges::max_element(lats))};
+    };
+    cellStart.assign(static_cast<size_t>(cols) * rows + 1, 0);
+    for (const auto &t : triangles) {
+        const auto [c0, c1, r0, r1] = cellRange(t);
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                ++cellStart[r * cols + c + 1];
+    }
+    for (size_t i = 1; i < cellStart.size(); ++i)
+        cellStart[i] += cellStart[i - 1];
+    cellItems.resize(cellStart.back());
+    std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for (uint32_t i = 0; i < triangles.size(); ++i) {
+        const auto [c0, c1, r0, r1] = cellRange(triangles[i]);
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                cellItems[fill[r * cols + c]++] = i;
+    }
+    return true;
+}
+
+void PiecewiseAffine::clear () {
+    triangles.clear();
+    cellStart.clear();
+    cellItems.clear();
+    cols = rows = 0;
+}
+
+/**
+ * @brief 查找经纬度所在三角形
+ * @return 三角形索引,凸包外为-1
+ */
+int PiecewiseAffine::locate (const double latitude, const double longitude) const {
+    if (triangles.empty())
+        return -1;
+    const double fc = (longitude - minLon) * invCellLon, fr = (latitude - minLat) * invCellLat;
+    if ((fc < 0) || (fr < 0) || (fc > cols) || (fr > rows))
+        return -1;
+    const int c = std::min(static_cast<int>(fc), cols - 1), r = std::min(static_cast<int>(fr), rows - 1);
+    constexpr double eps = 1e-12;
+    for (uint32_t k = cellStart[r * cols + c]; k < cellStart[r * cols + c + 1]; ++k) {
+        const Triangle &t = triangles[cellItems[k]];
+        const double du = longitude - t.lon0, dv = latitude - t.lat0;
+        const double s = (du * t.e2v - t.e2u * dv) * t.invDet;
+        const double w = (t.e1u * dv - du * t.e1v) * t.invDet;
+        if ((s >= -eps) && (w >= -eps) && (s + w <= 1 + eps))
+            return static_cast<int>(cellItems[k]);
+    }
+    return -1;
+}
+
+/**
+ * @brief 转换经纬度至平面坐标系
+ * @return [x,y]
+ */
+std::pair<double, double> PiecewiseAffine::transform (const double latitude, const double longitude) const {
+    const int idx = locate(latitude, longitude);
+    const auto &p = idx < 0 ? global : triangles[idx].params;
+    return {p[0] * longitude + p[1] * latitude + p[2], p[3] * longitude + p[4] * latitude + p[5]};
+}
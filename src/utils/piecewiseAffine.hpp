@@ -0,0 +1,49 @@
+#ifndef CHARTNAVIGATION_PIECEWISEAFFINE_HPP
+#define CHARTNAVIGATION_PIECEWISEAFFINE_HPP
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "controlPoint.hpp"
+
+/**
+ * @brief 页面映射模型(映射文件页头 "model")
+ */
+enum class TransformModel {
+    Affine, // 全局仿射(默认)
+    Piecewise // 分片仿射,用于含插图/不按比例区域的航图
+};
+
+/**
+ * 分片仿射:内点Delaunay三角剖分,每个三角形一个精确仿射
+ * 均匀网格记录与每个格子相交的三角形,查找为常数时间;凸包外退回全局仿射
+ */
+class PiecewiseAffine {
+    public:
+        bool build (std::span<const ControlPoint> points, const std::vector<uint64_t> &inlierMask,
+                    const Eigen::Vector3d &paramsX, const Eigen::Vector3d &paramsY);
+        void clear ();
+        [[nodiscard]] bool empty () const { return triangles.empty(); }
+        [[nodiscard]] size_t size () const { return triangles.size(); }
+        [[nodiscard]] int locate (double latitude, double longitude) const;
+        [[nodiscard]] std::pair<double, double> transform (double latitude, double longitude) const;
+    private:
+        struct Triangle {
+            double lon0, lat0; // 顶点a
+            double e1u, e1v, e2u, e2v; // 边ab ac
+            double invDet;
+            std::array<double, 6> params; // x=p0*经度+p1*纬度+p2 y=p3*经度+p4*纬度+p5
+        };
+
+        std::vector<Triangle> triangles;
+        std::array<double, 6> global{}; // 凸包外使用
+        // 加速网格(CSR): 格子c的三角形为 cellItems[cellStart[c], cellStart[c+1])
+        double minLon{}, minLat{}, invCellLon{}, invCellLat{};
+        int cols{0}, rows{0};
+        std::vector<uint32_t> cellStart, cellItems;
+};
+
+#endif //CHARTNAVIGATION_PIECEWISEAFFINE_HPP
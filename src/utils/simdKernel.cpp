@@ -0,0 +1,232 @@
+#include "simdKernel.hpp"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHARTNAVIGATION_X86
+#include <immintrin.h>
+#endif
+
+void PointBuffer::reserve (const size_t n) {
+    lon.reserve(n);
+    lat.reserve(n);
+    x.reserve(n);
+    y.reserve(n);
+}
+
+void PointBuffer::push (const double latitude, const double longitude, const double xVal, const double yVal) {
+    lon.push_back(longitude);
+    lat.push_back(latitude);
+    x.push_back(xVal);
+    y.push_back(yVal);
+}
+
+void PointBuffer::clear () {
+    lon.clear();
+    lat.clear();
+    x.clear();
+    y.clear();
+}
+
+namespace
+{
+/**
+ * @brief 标量版本,同时处理SIMD剩余的尾部
+ * @param begin 起始索引
+ */
+void inlierScalar (const PointBuffer &points, const double *p, const double thresholdSq, uint64_t *mask,
+                   const size_t begin) {
+    for (size_t i = begin; i < points.size(); ++i) {
+        const double dx = p[0] * points.lon[i] + p[1] * points.lat[i] + p[2] - points.x[i];
+        const double dy = p[3] * points.lon[i] + p[4] * points.lat[i] + p[5] - points.y[i];
+        if (dx * dx + dy * dy < thresholdSq)
+            mask[i >> 6] |= uint64_t{1} << (i & 63);
+    }
+}
+
+/**
+ * @brief 标量仿射,同时处理SIMD剩余的尾部(float在double下计算)
+ */
+template <typename T>
+void affineScalar (const double *p, const T *u, const T *v, T *outX, T *outY, const size_t begin, const size_t n) {
+    for (size_t i = begin; i < n; ++i) {
+        const double uu = u[i], vv = v[i];
+        outX[i] = static_cast<T>(p[0] * uu + p[1] * vv + p[2]);
+        outY[i] = static_cast<T>(p[3] * uu + p[4] * vv + p[5]);
+    }
+}
+
+#ifdef CHARTNAVIGATION_X86
+/**
+ * @brief SSE2 一次2个点 (x86-64 基线指令集)
+ */
+size_t inlierSse2 (const PointBuffer &points, const double *p, const double thresholdSq, uint64_t *mask) {
+    const size_t n = points.size() & ~size_t{1};
+    const __m128d a0 = _mm_set1_pd(p[0]), a1 = _mm_set1_pd(p[1]), a2 = _mm_set1_pd(p[2]);
+    const __m128d b0 = _mm_set1_pd(p[3]), b1 = _mm_set1_pd(p[4]), b2 = _mm_set1_pd(p[5]);
+    const __m128d t2 = _mm_set1_pd(thresholdSq);
+    for (size_t i = 0; i < n; i += 2) {
+        const __m128d lon = _mm_loadu_pd(points.lon.data() + i);
+        const __m128d lat = _mm_loadu_pd(points.lat.data() + i);
+        const __m128d dx = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a0, lon), _mm_mul_pd(a1, lat)), a2),
+                                      _mm_loadu_pd(points.x.data() + i));
+        const __m128d dy = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(b0, lon), _mm_mul_pd(b1, lat)), b2),
+                                      _mm_loadu_pd(points.y.data() + i));
+        const __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        const auto bits = static_cast<uint64_t>(_mm_movemask_pd(_mm_cmplt_pd(d2, t2)));
+        mask[i >> 6] |= bits << (i & 63);
+    }
+    return n;
+}
+
+/**
+ * @brief AVX2+FMA 一次4个点,运行时检测后调用
+ */
+__attribute__((target("avx2,fma")))
+size_t inlierAvx2 (const PointBuffer &points, const double *p, const double thresholdSq, uint64_t *mask) {
+    const size_t n = points.size() & ~size_t{3};
+    const __m256d a0 = _mm256_set1_pd(p[0]), a1 = _mm256_set1_pd(p[1]), a2 = _mm256_set1_pd(p[2]);
+    const __m256d b0 = _mm256_set1_pd(p[3]), b1 = _mm256_set1_pd(p[4]), b2 = _mm256_set1_pd(p[5]);
+    const __m256d t2 = _mm256_set1_pd(thresholdSq);
+    for (size_t i = 0; i < n; i += 4) {
+        const __m256d lon = _mm256_loadu_pd(points.lon.data() + i);
+        const __m256d lat = _mm256_loadu_pd(points.lat.data() + i);
+        const __m256d dx = _mm256_sub_pd(_mm256_fmadd_pd(a0, lon, _mm256_fmadd_pd(a1, lat, a2)),
+                                         _mm256_loadu_pd(points.x.data() + i));
+        const __m256d dy = _mm256_sub_pd(_mm256_fmadd_pd(b0, lon, _mm256_fmadd_pd(b1, lat, b2)),
+                                         _mm256_loadu_pd(points.y.data() + i));
+        const __m256d d2 = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+        const auto bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_cmp_pd(d2, t2, _CMP_LT_OQ)));
+        mask[i >> 6] |= bits << (i & 63);
+    }
+    return n;
+}
+
+/**
+ * @brief 仿射 SSE2 double 一次2个点
+ */
+size_t affineSse2 (const double *p, const double *u, const double *v, double *outX, double *outY, const size_t count) {
+    const size_t n = count & ~size_t{1};
+    const __m128d a0 = _mm_set1_pd(p[0]), a1 = _mm_set1_pd(p[1]), a2 = _mm_set1_pd(p[2]);
+    const __m128d b0 = _mm_set1_pd(p[3]), b1 = _mm_set1_pd(p[4]), b2 = _mm_set1_pd(p[5]);
+    for (size_t i = 0; i < n; i += 2) {
+        const __m128d uu = _mm_loadu_pd(u + i), vv = _mm_loadu_pd(v + i);
+        _mm_storeu_pd(outX + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(a0, uu), _mm_mul_pd(a1, vv)), a2));
+        _mm_storeu_pd(outY + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(b0, uu), _mm_mul_pd(b1, vv)), b2));
+    }
+    return n;
+}
+
+/**
+ * @brief 仿射 SSE2 float 一次4个点,内部转为double计算
+ */
+size_t affineSse2 (const double *p, const float *u, const float *v, float *outX, float *outY, const size_t count) {
+    const size_t n = count & ~size_t{3};
+    const __m128d a0 = _mm_set1_pd(p[0]), a1 = _mm_set1_pd(p[1]), a2 = _mm_set1_pd(p[2]);
+    const __m128d b0 = _mm_set1_pd(p[3]), b1 = _mm_set1_pd(p[4]), b2 = _mm_set1_pd(p[5]);
+    const auto apply = [](const __m128d c0, const __m128d c1, const __m128d c2, const __m128d uu, const __m128d vv) {
+        return _mm_add_pd(_mm_add_pd(_mm_mul_pd(c0, uu), _mm_mul_pd(c1, vv)), c2);
+    };
+    for (size_t i = 0; i < n; i += 4) {
+        const __m128 uf = _mm_loadu_ps(u + i), vf = _mm_loadu_ps(v + i);
+        const __m128d uLow = _mm_cvtps_pd(uf), uHigh = _mm_cvtps_pd(_mm_movehl_ps(uf, uf));
+        const __m128d vLow = _mm_cvtps_pd(vf), vHigh = _mm_cvtps_pd(_mm_movehl_ps(vf, vf));
+        _mm_storeu_ps(outX + i, _mm_movelh_ps(_mm_cvtpd_ps(apply(a0, a1, a2, uLow, vLow)),
+                                              _mm_cvtpd_ps(apply(a0, a1, a2, uHigh, vHigh))));
+        _mm_storeu_ps(outY + i, _mm_movelh_ps(_mm_cvtpd_ps(apply(b0, b1, b2, uLow, vLow)),
+                                              _mm_cvtpd_ps(apply(b0, b1, b2, uHigh, vHigh))));
+    }
+    return n;
+}
+
+/**
+ * @brief 仿射 AVX2+FMA double 一次4个点
+ */
+__attribute__((target("avx2,fma")))
+size_t affineAvx2 (const double *p, const double *u, const double *v, double *outX, double *outY, const size_t count) {
+    const size_t n = count & ~size_t{3};
+    const __m256d a0 = _mm256_set1_pd(p[0]), a1 = _mm256_set1_pd(p[1]), a2 = _mm256_set1_pd(p[2]);
+    const __m256d b0 = _mm256_set1_pd(p[3]), b1 = _mm256_set1_pd(p[4]), b2 = _mm256_set1_pd(p[5]);
+    for (size_t i = 0; i < n; i += 4) {
+        const __m256d uu = _mm256_loadu_pd(u + i), vv = _mm256_loadu_pd(v + i);
+        _mm256_storeu_pd(outX + i, _mm256_fmadd_pd(a0, uu, _mm256_fmadd_pd(a1, vv, a2)));
+        _mm256_storeu_pd(outY + i, _mm256_fmadd_pd(b0, uu, _mm256_fmadd_pd(b1, vv, b2)));
+    }
+    return n;
+}
+
+/**
+ * @brief 仿射 AVX2+FMA float 一次4个点,内部转为double计算
+ */
+__attribute__((target("avx2,fma")))
+size_t affineAvx2 (const double *p, const float *u, const float *v, float *outX, float *outY, const size_t count) {
+    const size_t n = count & ~size_t{3};
+    const __m256d a0 = _mm256_set1_pd(p[0]), a1 = _mm256_set1_pd(p[1]), a2 = _mm256_set1_pd(p[2]);
+    const __m256d b0 = _mm256_set1_pd(p[3]), b1 = _mm256_set1_pd(p[4]), b2 = _mm256_set1_pd(p[5]);
+    for (size_t i = 0; i < n; i += 4) {
+        const __m256d uu = _mm256_cvtps_pd(_mm_loadu_ps(u + i)), vv = _mm256_cvtps_pd(_mm_loadu_ps(v + i));
+        _mm_storeu_ps(outX + i, _mm256_cvtpd_ps(_mm256_fmadd_pd(a0, uu, _mm256_fmadd_pd(a1, vv, a2))));
+        _mm_storeu_ps(outY + i, _mm256_cvtpd_ps(_mm256_fmadd_pd(b0, uu, _mm256_fmadd_pd(b1, vv, b2))));
+    }
+    return n;
+}
+
+bool hasAvx2 () {
+    static const bool support = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return support;
+}
+#endif
+}
+
+/**
+ * @brief 计算内点位掩码
+ * @param points 控制点
+ * @param paramsX x参数
+ * @param paramsY y参数
+ * @param thresholdSq 阈值平方
+ * @param mask 输出位掩码,至少 (n+63)/64 个字
+ * @return 内点数量
+ */
+size_t countInliers (const PointBuffer &points, const Eigen::Vector3d &paramsX, const Eigen::Vector3d &paramsY,
+                     const double thresholdSq, uint64_t *mask) {
+    const size_t words = (points.size() + 63) / 64;
+    std::memset(mask, 0, words * sizeof(uint64_t));
+    const double p[6]{paramsX(0), paramsX(1), paramsX(2), paramsY(0), paramsY(1), paramsY(2)};
+    size_t done{0};
+#ifdef CHARTNAVIGATION_X86
+    done = hasAvx2() ? inlierAvx2(points, p, thresholdSq, mask) : inlierSse2(points, p, thresholdSq, mask);
+#endif
+    inlierScalar(points, p, thresholdSq, mask, done);
+    size_t count{0};
+    for (size_t i = 0; i < words; ++i)
+        count += std::popcount(mask[i]);
+    return count;
+}
+
+/**
+ * @brief 批量仿射 (outX,outY) = (p0*u+p1*v+p2, p3*u+p4*v+p5)
+ * @param params 6个参数
+ * @param u,v 输入(SoA)
+ * @param outX,outY 输出(SoA)
+ * @param n 点数
+ */
+void affineBatch (const double *params, const double *u, const double *v, double *outX, double *outY, const size_t n) {
+    size_t done{0};
+#ifdef CHARTNAVIGATION_X86
+    done = hasAvx2() ? affineAvx2(params, u, v, outX, outY, n) : affineSse2(params, u, v, outX, outY, n);
+#endif
+    affineScalar(params, u, v, outX, outY, done, n);
+}
+
+/**
+ * @brief 批量仿射 float 版本
+ * @note 经纬度乘以参数后数量级很大,结果却只有几百,float直接计算会严重抵消,因此内部用double计算
+ */
+void affineBatch (const double *params, const float *u, const float *v, float *outX, float *outY, const size_t n) {
+    size_t done{0};
+#ifdef CHARTNAVIGATION_X86
+    done = hasAvx2() ? affineAvx2(params, u, v, outX, outY, n) : affineSse2(params, u, v, outX, outY, n);
+#endif
+    affineScalar(params, u, v, outX, outY, done, n);
+}
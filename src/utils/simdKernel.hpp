@@ -0,0 +1,33 @@
+#ifndef CHARTNAVIGATION_SIMDKERNEL_HPP
+#define CHARTNAVIGATION_SIMDKERNEL_HPP
+
+#include <cstdint>
+#include <vector>
+#include <Eigen/Dense>
+
+/**
+ * @brief 控制点的SoA存储,便于向量化
+ */
+struct PointBuffer {
+    std::vector<double> lon, lat, x, y;
+
+    [[nodiscard]] size_t size () const { return lon.size(); }
+    void reserve (size_t n);
+    void push (double latitude, double longitude, double xVal, double yVal);
+    void clear ();
+};
+
+size_t countInliers (const PointBuffer &points, const Eigen::Vector3d &paramsX, const Eigen::Vector3d &paramsY,
+                     double thresholdSq, uint64_t *mask);
+
+void affineBatch (const double *params, const double *u, const double *v, double *outX, double *outY, size_t n);
+void affineBatch (const double *params, const float *u, const float *v, float *outX, float *outY, size_t n);
+
+/**
+ * @brief 位掩码中第i位是否置位
+ */
+inline bool testBit (const std::vector<uint64_t> &mask, const size_t i) {
+    return (mask[i >> 6] >> (i & 63)) & 1;
+}
+
+#endif //CHARTNAVIGATION_SIMDKERNEL_HPP
@@ -0,0 +1,225 @@
+#include "stateBroadcaster.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <ranges>
+
+#include "tools/constValue.hpp"
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+
+namespace
+{
+constexpr char FULL_FRAME{'F'}, DELTA_FRAME{'D'};
+constexpr size_t HEADER_SIZE{1 + 4 + 2 + 2};
+constexpr size_t TARGET_SIZE{2 + 4 + 4 + 2 + 2};
+
+template <typename T>
+void put (std::string &out, const T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+}
+
+
+StateBroadcaster::Client::Client (asio::ip::tcp::socket socket) : ws(std::move(socket)),
+                                                                   signal(ws.get_executor()) {}
+
+/**
+ * @param port 监听端口(0为系统分配)
+ */
+StateBroadcaster::StateBroadcaster (const unsigned short port) : workGuard(asio::make_work_guard(io_context)),
+                                                                 acceptor(io_context) {
+    const asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(asio::socket_base::reuse_address(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+    boundPort = acceptor.local_endpoint().port();
+    asio::co_spawn(io_context, accept(), asio::detached);
+    worker = std::thread([this] { io_context.run(); });
+}
+
+StateBroadcaster::~StateBroadcaster () {
+    close();
+}
+
+/**
+ * @brief 发布一帧(任意线程调用),编码与发送在 io 线程完成
+ * @param points 全部目标
+ */
+void StateBroadcaster::publish (const std::span<const TrackPoint> points) {
+    if (closed)
+        return;
+    asio::post(io_context, [this, copy = std::vector(points.begin(), points.end())] { update(copy); });
+}
+
+/**
+ * @brief 关闭全部连接并停止线程
+ */
+void StateBroadcaster::close () {
+    if (closed)
+        return;
+    closed = true;
+    asio::post(io_context, [this] {
+        boost::system::error_code ec;
+        acceptor.close(ec);
+        for (const auto &client : handshaking)
+            beast::get_lowest_layer(client->ws).socket().close(ec);
+        for (const auto &client : clients) {
+            client->closed = true;
+            beast::get_lowest_layer(client->ws).socket().close(ec);
+            client->signal.cancel();
+        }
+        workGuard.reset();
+    });
+    if (worker.joinable())
+        worker.join();
+}
+
+asio::awaitable<void> StateBroadcaster::accept () {
+    while (acceptor.is_open()) {
+        boost::system::error_code ec;
+        auto socket = co_await acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+        if (ec)
+            break;
+        socket.set_option(asio::ip::tcp::no_delay(true), ec);
+        auto client = std::make_shared<Client>(std::move(socket));
+        asio::co_spawn(io_context, session(client), asio::detached);
+    }
+}
+
+/**
+ * @brief 单个客户端:握手后发送一次全量,之后只读(处理 ping/close)
+ */
+asio::awaitable<void> StateBroadcaster::session (const std::shared_ptr<Client> client) {
+    boost::system::error_code ec;
+    // 握手超时30秒(不完成握手的连接不会一直占用);之后空闲300秒断开,期间发送 ping 保活
+    client->ws.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+    handshaking.push_back(client);
+    co_await client->ws.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+    handshaking.remove(client);
+    if (ec || !acceptor.is_open())
+        co_return;
+    client->ws.binary(true);
+    clients.push_back(client);
+    asio::co_spawn(io_context, drain(client), asio::detached);
+    beast::flat_buffer buffer;
+    while (!client->closed) {
+        const size_t size = co_await client->ws.async_read(buffer, asio::redirect_error(asio::use_awaitable, ec));
+        if (ec)
+            break;
+        buffer.consume(size);
+    }
+    client->closed = true;
+    client->signal.cancel();
+    clients.remove(client);
+}
+
+/**
+ * @brief 客户端发送队列:同一时刻只有一条在途消息
+ */
+asio::awaitable<void> StateBroadcaster::drain (const std::shared_ptr<Client> client) {
+    boost::system::error_code ec;
+    while (!client->closed) {
+        std::shared_ptr<const std::string> message;
+        if (client->needFull) {
+            client->needFull = false;
+            client->pending.reset();
+            message = snapshot();
+        } else if (client->pending)
+            message = std::move(client->pending);
+        else {
+            client->signal.expires_at(asio::steady_timer::time_point::max());
+            co_await client->signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            continue;
+        }
+        co_await client->ws.async_write(asio::buffer(*message), asio::redirect_error(asio::use_awaitable, ec));
+        if (ec)
+            client->closed = true;
+    }
+}
+
+/**
+ * @brief 计算差分并分发
+ */
+void StateBroadcaster::update (const std::vector<TrackPoint> &points) {
+    std::vector<std::pair<uint16_t, Quantized>> changed;
+    std::vector<uint16_t> removed;
+    std::unordered_map<uint16_t, Quantized> next;
+    next.reserve(points.size());
+    for (const auto &point : points) {
+        const auto id = static_cast<uint16_t>(point.id);
+        const Quantized q = quantize(point);
+        next[id] = q;
+        if (const auto it = current.find(id); (it == current.end()) || !(it->second == q))
+            changed.emplace_back(id, q);
+    }
+    for (const auto id : current | std::views::keys)
+        if (!next.contains(id))
+            removed.push_back(id);
+    current = std::move(next);
+    ++sequence;
+    snapshotCache.reset();
+    if (changed.empty() && removed.empty())
+        return;
+    // 编码一次,所有客户端共享
+    auto message = std::make_shared<std::string>();
+    message->reserve(HEADER_SIZE + changed.size() * TARGET_SIZE + removed.size() * 2);
+    message->push_back(DELTA_FRAME);
+    put(*message, sequence);
+    put(*message, static_cast<uint16_t>(changed.size()));
+    put(*message, static_cast<uint16_t>(removed.size()));
+    for (const auto &[id, q] : changed) {
+        put(*message, id);
+        put(*message, q.lat);
+        put(*message, q.lon);
+        put(*message, q.alt);
+        put(*message, q.trk);
+    }
+    for (const auto id : removed)
+        put(*message, id);
+    const std::shared_ptr<const std::string> shared = std::move(message);
+    for (const auto &client : clients) {
+        if (client->pending) { // 在途一条之外又积压一条:丢弃差分,之后补发全量
+            client->pending.reset();
+            client->needFull = true;
+        } else if (!client->needFull)
+            client->pending = shared;
+        client->signal.cancel();
+    }
+}
+
+/**
+ * @brief 当前状态的全量帧,同一序号只编码一次
+ */
+std::shared_ptr<const std::string> StateBroadcaster::snapshot () {
+    if (snapshotCache)
+        return snapshotCache;
+    auto message = std::make_shared<std::string>();
+    message->reserve(HEADER_SIZE + current.size() * TARGET_SIZE);
+    message->push_back(FULL_FRAME);
+    put(*message, sequence);
+    put(*message, static_cast<uint16_t>(current.size()));
+    put(*message, static_cast<uint16_t>(0));
+    for (const auto &[id, q] : current) {
+        put(*message, id);
+        put(*message, q.lat);
+        put(*message, q.lon);
+        put(*message, q.alt);
+        put(*message, q.trk);
+    }
+    snapshotCache = std::move(message);
+    return snapshotCache;
+}
+
+StateBroadcaster::Quantized StateBroadcaster::quantize (const TrackPoint &point) {
+    const double altFt = std::clamp(std::round(point.alt * m2ft / 10), -32768.0, 32767.0);
+    return {
+        static_cast<int32_t>(std::lround(point.latitude * 1e7)), static_cast<int32_t>(std::lround(point.longitude * 1e7)),
+        static_cast<int16_t>(altFt), static_cast<uint16_t>(std::lround(std::fmod(point.track + 360, 360) * 100) % 36000)
+    };
+}
@@ -0,0 +1,69 @@
+#ifndef CHARTNAVIGATION_STATEBROADCASTER_HPP
+#define CHARTNAVIGATION_STATEBROADCASTER_HPP
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <list>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "utils/trackArchive.hpp"
+
+/**
+ * 局域网 WebSocket 广播 (二进制,小端)
+ * 消息头 [类型 1字节 'F'全量/'D'差分][序号 uint32][变化数 uint16][消失数 uint16]
+ * 变化目标 [id uint16][纬度 int32 1e-7度][经度 int32 1e-7度][高度 int16 10英尺][航向 uint16 0.01度]
+ * 消失目标 [id uint16]
+ * 差分帧只包含相对上一帧量化值发生变化的目标;每个客户端在途一条、排队一条,再积压时丢弃差分,之后补发一次全量帧
+ */
+class StateBroadcaster {
+    public:
+        explicit StateBroadcaster (unsigned short port);
+        ~StateBroadcaster ();
+        StateBroadcaster (const StateBroadcaster &) = delete;
+        StateBroadcaster& operator= (const StateBroadcaster &) = delete;
+
+        void publish (std::span<const TrackPoint> points);
+        void close ();
+        [[nodiscard]] unsigned short port () const { return boundPort; }
+    private:
+        struct Quantized {
+            int32_t lat, lon;
+            int16_t alt;
+            uint16_t trk;
+            bool operator== (const Quantized &) const = default;
+        };
+        struct Client {
+            explicit Client (boost::asio::ip::tcp::socket socket);
+            boost::beast::websocket::stream<boost::beast::tcp_stream> ws;
+            boost::asio::steady_timer signal; // 有新消息时取消等待
+            std::shared_ptr<const std::string> pending; // 在途消息之后待发送的差分(至多一帧)
+            bool needFull{true}; // 下一次发送全量帧
+            bool closed{false};
+        };
+
+        boost::asio::io_context io_context{};
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> workGuard;
+        boost::asio::ip::tcp::acceptor acceptor;
+        unsigned short boundPort{0};
+        std::list<std::shared_ptr<Client>> clients; // 仅在 io 线程访问
+        std::list<std::shared_ptr<Client>> handshaking; // 尚未完成握手的连接,关闭时同样需要断开
+        std::unordered_map<uint16_t, Quantized> current; // 最新量化状态
+        uint32_t sequence{0};
+        std::shared_ptr<const std::string> snapshotCache; // 当前序号的全量帧
+        std::thread worker;
+        bool closed{false};
+
+        boost::asio::awaitable<void> accept ();
+        boost::asio::awaitable<void> session (std::shared_ptr<Client> client);
+        boost::asio::awaitable<void> drain (std::shared_ptr<Client> client);
+        void update (const std::vector<TrackPoint> &points);
+        std::shared_ptr<const std::string> snapshot ();
+        static Quantized quantize (const TrackPoint &point);
+};
+
+#endif //CHARTNAVIGATION_STATEBROADCASTER_HPP
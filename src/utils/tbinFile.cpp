@@ -0,0 +1,379 @@
+#include "tbinFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+
+#include "tools/hash.hpp"
+
+namespace
+{
+constexpr char MAGIC[4]{'T', 'B', 'I', 'N'};
+constexpr uint32_t VERSION{2};
+constexpr uint32_t NONE{std::numeric_limits<uint32_t>::max()};
+
+/**
+ * @brief 源文件标识
+ */
+struct SourceStamp {
+    uint64_t size;
+    int64_t time;
+};
+
+std::optional<SourceStamp> stampOf (const std::filesystem::path &path) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return std::nullopt;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return std::nullopt;
+    return SourceStamp{size, static_cast<int64_t>(time.time_since_epoch().count())};
+}
+
+/**
+ * @brief 源文件内容哈希(内存映射)
+ */
+std::optional<uint64_t> contentHash (const std::filesystem::path &path) {
+    try {
+        const boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+        const boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+        return fnv1a(FNV_OFFSET, region.get_address(), region.get_size());
+    } catch (const boost::interprocess::interprocess_exception &) {
+        return std::nullopt;
+    }
+}
+
+template <typename T>
+void write (std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void writeArray (std::ofstream &file, const std::vector<T> &values) {
+    file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+}
+
+
+struct TbinFile::Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint32_t chartCount, slotCount;
+    uint32_t pageIndexCount, pageCount;
+    uint32_t pointCount, maskCount;
+    uint64_t slotOffset, chartOffset, pageIndexOffset, pageOffset, pointOffset, maskOffset, nameOffset;
+};
+
+struct TbinFile::ChartRecord {
+    uint64_t nameHash;
+    uint32_t nameOffset, nameLength;
+    uint32_t pageIndexBegin, pageIndexCount; // 页索引[页码] -> 页表序号(NONE为无映射)
+};
+
+struct TbinFile::PageRecord {
+    int32_t page;
+    uint32_t type, model, reserved;
+    double rotate, threshold;
+    uint32_t pointBegin, pointCount;
+    uint32_t maskBegin, hasFit;
+    double paramsX[3], paramsY[3];
+    double rms;
+};
+
+/**
+ * @brief 编译映射文件:解析、拟合全部页面后写入 .Tbin
+ * @param tmapPath 源映射文件
+ * @param tbinPath 输出路径
+ * @param seed 全局种子,各页按 chartPageSeed 派生(与 TmapBuilder 校验结果一致)
+ * @return 是否成功
+ * @note 先写临时文件再改名,失败时删除临时文件
+ */
+bool TbinFile::compile (const std::filesystem::path &tmapPath, const std::filesystem::path &tbinPath,
+                        const uint64_t seed) {
+    static_assert(std::is_trivially_copyable_v<Header> && (sizeof(Header) % 8 == 0));
+    static_assert(std::is_trivially_copyable_v<PageRecord> && (sizeof(PageRecord) % 8 == 0));
+    static_assert(sizeof(ChartRecord) % 8 == 0);
+    const auto stamp = stampOf(tmapPath);
+    const auto hash = contentHash(tmapPath);
+    if (!stamp || !hash)
+        return false;
+    const auto charts = readTmap(tmapPath);
+    if (charts.empty())
+        return false;
+    std::vector<ChartRecord> chartRecords;
+    std::vector<uint32_t> pageIndex;
+    std::vector<PageRecord> pages;
+    std::vector<ControlPoint> points;
+    std::vector<uint64_t> masks;
+    std::string names;
+    for (const auto &[name, mapping] : charts) {
+        ChartRecord record{nameHash(name), static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size()),
+                           static_cast<uint32_t>(pageIndex.size()), static_cast<uint32_t>(mapping.size())};
+        names += name;
+        pageIndex.resize(pageIndex.size() + record.pageIndexCount, NONE);
+        for (const auto &pageMapping : mapping) {
+            if (!pageMapping)
+                continue;
+            PageRecord page{pageMapping->page, static_cast<uint32_t>(pageMapping->type),
+                            static_cast<uint32_t>(pageMapping->model), 0, pageMapping->rotate, pageMapping->threshold, static_cast<uint32_t>(points.size()),
+                            static_cast<uint32_t>(pageMapping->data.size()), static_cast<uint32_t>(masks.size()), 0,
+                            {}, {}, 0};
+            AffineTransformer transformer;
+            RansacOptions options;
+            options.seed = chartPageSeed(seed, name, pageMapping->page);
+            options.threads = 1;
+            if (transformer.loadData(pageMapping->data, pageMapping->threshold, options)) {
+                const AffineFit fit = transformer.result();
+                page.hasFit = 1;
+                for (int i = 0; i < 3; ++i) {
+                    page.paramsX[i] = fit.paramsX(i);
+                    page.paramsY[i] = fit.paramsY(i);
+                }
+                page.rms = fit.rms;
+                masks.insert(masks.end(), fit.inlierMask.begin(), fit.inlierMask.end());
+            }
+            points.insert(points.end(), pageMapping->data.begin(), pageMapping->data.end());
+            pageIndex[record.pageIndexBegin + pageMapping->page] = static_cast<uint32_t>(pages.size());
+            pages.push_back(page);
+        }
+        chartRecords.push_back(record);
+    }
+    // 开放寻址槽,装载因子不超过1/2
+    uint32_t slotCount = 2;
+    while (slotCount < chartRecords.size() * 2)
+        slotCount <<= 1;
+    std::vector<uint32_t> slots(slotCount, NONE);
+    for (uint32_t i = 0; i < chartRecords.size(); ++i) {
+        uint32_t slot = chartRecords[i].nameHash & (slotCount - 1);
+        while (slots[slot] != NONE)
+            slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = i;
+    }
+    pageIndex.resize((pageIndex.size() + 1) & ~size_t{1}, NONE); // 8字节对齐(槽数为2的幂,已对齐)
+    Header header{{}, VERSION, stamp->size, stamp->time, *hash,
+                  static_cast<uint32_t>(chartRecords.size()), slotCount,
+                  static_cast<uint32_t>(pageIndex.size()), static_cast<uint32_t>(pages.size()),
+                  static_cast<uint32_t>(points.size()), static_cast<uint32_t>(masks.size()),
+                  0, 0, 0, 0, 0, 0, 0};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.slotOffset = sizeof(Header);
+    header.chartOffset = header.slotOffset + slots.size() * sizeof(uint32_t);
+    header.pageIndexOffset = header.chartOffset + chartRecords.size() * sizeof(ChartRecord);
+    header.pageOffset = header.pageIndexOffset + pageIndex.size() * sizeof(uint32_t);
+    header.pointOffset = header.pageOffset + pages.size() * sizeof(PageRecord);
+    header.maskOffset = header.pointOffset + points.size() * sizeof(ControlPoint);
+    header.nameOffset = header.maskOffset + masks.size() * sizeof(uint64_t);
+    const std::filesystem::path temp = tbinPath.string() + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+        write(out, header);
+        writeArray(out, slots);
+        writeArray(out, chartRecords);
+        writeArray(out, pageIndex);
+        writeArray(out, pages);
+        writeArray(out, points);
+        writeArray(out, masks);
+        out.write(names.data(), static_cast<std::streamsize>(names.size()));
+        out.close();
+        if (!out) {
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, tbinPath, ec);
+    if (!ec)
+        return true;
+    std::filesystem::remove(temp, ec);
+    return false;
+}
+
+/**
+ * @brief 映射 .Tbin 并校验是否与源文件一致
+ * @param tbinPath 编译文件
+ * @param tmapPath 源映射文件
+ * @return 可用(不存在/损坏/过期时为否,调用方应改用JSON)
+ * @note 大小与修改时间一致即视为最新;不一致时再比较内容哈希(仅被touch的文件仍可用)
+ */
+bool TbinFile::open (const std::filesystem::path &tbinPath, const std::filesystem::path &tmapPath) {
+    close();
+    const auto stamp = stampOf(tmapPath);
+    if (!stamp)
+        return false;
+    try {
+        file = boost::interprocess::file_mapping(tbinPath.c_str(), boost::interprocess::read_only);
+        region = boost::interprocess::mapped_region(file, boost::interprocess::read_only);
+    } catch (const boost::interprocess::interprocess_exception &) {
+        close();
+        return false;
+    }
+    base = static_cast<const std::byte*>(region.get_address());
+    size = region.get_size();
+    // 结构校验
+    if (size < sizeof(Header)) {
+        close();
+        return false;
+    }
+    const auto header = at<Header>(0);
+    const auto within = [&](const uint64_t offset, const uint64_t bytes) {
+        return (offset <= size) && (bytes <= size - offset);
+    };
+    const bool valid = (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0) && (header.version == VERSION) &&
+                       (header.slotCount != 0) && ((header.slotCount & (header.slotCount - 1)) == 0) &&
+                       within(header.slotOffset, uint64_t{header.slotCount} * sizeof(uint32_t)) &&
+                       within(header.chartOffset, uint64_t{header.chartCount} * sizeof(ChartRecord)) &&
+                       within(header.pageIndexOffset, uint64_t{header.pageIndexCount} * sizeof(uint32_t)) &&
+                       within(header.pageOffset, uint64_t{header.pageCount} * sizeof(PageRecord)) &&
+                       within(header.pointOffset, uint64_t{header.pointCount} * sizeof(ControlPoint)) &&
+                       within(header.maskOffset, uint64_t{header.maskCount} * sizeof(uint64_t)) &&
+                       within(header.nameOffset, 0);
+    // 过期校验
+    bool fresh = (header.sourceSize == stamp->size) && (header.sourceTime == stamp->time);
+    if (valid && !fresh && (header.sourceSize == stamp->size))
+        fresh = contentHash(tmapPath) == header.sourceHash;
+    if (!valid || !fresh) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TbinFile::close () {
+    region = {};
+    file = {};
+    base = nullptr;
+    size = 0;
+}
+
+/**
+ * @brief 读取一份航图的全部页面(含拟合结果)
+ * @return 没有该航图时为空
+ */
+std::optional<ChartMapping> TbinFile::chart (const std::string &chartName) const {
+    const auto record = findChart(chartName);
+    if (!record)
+        return std::nullopt;
+    return readChart(*record);
+}
+
+/**
+ * @brief 读取全部航图(建立索引时使用)
+ */
+std::map<std::string, ChartMapping> TbinFile::charts () const {
+    std::map<std::string, ChartMapping> result;
+    if (!isOpen())
+        return result;
+    const auto header = at<Header>(0);
+    for (uint32_t i = 0; i < header.chartCount; ++i) {
+        const auto record = at<ChartRecord>(header.chartOffset, i);
+        const uint64_t nameAt = header.nameOffset + record.nameOffset;
+        if ((nameAt + record.nameLength > size) ||
+            (uint64_t{record.pageIndexBegin} + record.pageIndexCount > header.pageIndexCount))
+            continue;
+        result.emplace(std::string(reinterpret_cast<const char*>(base + nameAt), record.nameLength),
+                       readChart(record));
+    }
+    return result;
+}
+
+/**
+ * @brief 读取一页
+ * @param chartName 航图名
+ * @param pageNum 页码(起始为0)
+ * @return 不存在时为空
+ */
+std::shared_ptr<const PageMapping> TbinFile::page (const std::string &chartName, const int pageNum) const {
+    const auto record = findChart(chartName);
+    if (!record || (pageNum < 0) || (static_cast<uint32_t>(pageNum) >= record->pageIndexCount))
+        return nullptr;
+    const auto header = at<Header>(0);
+    const uint32_t index = at<uint32_t>(header.pageIndexOffset, record->pageIndexBegin + pageNum);
+    return index == NONE ? nullptr : readPage(index);
+}
+
+/**
+ * @brief 按对象大小读取(memcpy,不要求对齐)
+ */
+template <typename T>
+T TbinFile::at (const uint64_t offset, const size_t index) const {
+    T value;
+    std::memcpy(&value, base + offset + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+/**
+ * @brief 名字哈希定位槽位,线性探测
+ */
+std::optional<TbinFile::ChartRecord> TbinFile::findChart (const std::string &chartName) const {
+    if (!isOpen())
+        return std::nullopt;
+    const auto header = at<Header>(0);
+    const uint64_t hash = nameHash(chartName);
+    for (uint32_t probe = 0, slot = hash & (header.slotCount - 1); probe < header.slotCount;
+         ++probe, slot = (slot + 1) & (header.slotCount - 1)) {
+        const uint32_t index = at<uint32_t>(header.slotOffset, slot);
+        if ((index == NONE) || (index >= header.chartCount))
+            return std::nullopt;
+        const auto record = at<ChartRecord>(header.chartOffset, index);
+        if ((record.nameHash != hash) || (record.nameLength != chartName.size()))
+            continue;
+        const uint64_t nameAt = header.nameOffset + record.nameOffset;
+        if ((nameAt + record.nameLength <= size) &&
+            (std::memcmp(base + nameAt, chartName.data(), chartName.size()) == 0) &&
+            (uint64_t{record.pageIndexBegin} + record.pageIndexCount <= header.pageIndexCount))
+            return record;
+    }
+    return std::nullopt;
+}
+
+ChartMapping TbinFile::readChart (const ChartRecord &record) const {
+    const auto header = at<Header>(0);
+    ChartMapping mapping(std::min<uint32_t>(record.pageIndexCount, MAX_PAGE_COUNT));
+    for (uint32_t i = 0; i < mapping.size(); ++i)
+        if (const uint32_t index = at<uint32_t>(header.pageIndexOffset, record.pageIndexBegin + i); index != NONE)
+            if (auto pageMapping = readPage(index); pageMapping && (pageMapping->page == static_cast<int>(i)))
+                mapping[i] = std::move(pageMapping);
+    return mapping;
+}
+
+std::shared_ptr<const PageMapping> TbinFile::readPage (const uint32_t pageIndex) const {
+    const auto header = at<Header>(0);
+    if (pageIndex >= header.pageCount)
+        return nullptr;
+    const auto record = at<PageRecord>(header.pageOffset, pageIndex);
+    const size_t words = (record.pointCount + 63) / 64;
+    if ((uint64_t{record.pointBegin} + record.pointCount > header.pointCount) ||
+        (record.hasFit && (uint64_t{record.maskBegin} + words > header.maskCount)))
+        return nullptr;
+    auto pageMapping = std::make_shared<PageMapping>();
+    pageMapping->page = record.page;
+    pageMapping->type = static_cast<PageType>(record.type);
+    pageMapping->rotate = record.rotate;
+    pageMapping->threshold = record.threshold;
+    pageMapping->model = static_cast<TransformModel>(record.model);
+    pageMapping->data.resize(record.pointCount);
+    std::memcpy(pageMapping->data.data(), base + header.pointOffset + record.pointBegin * sizeof(ControlPoint),
+                record.pointCount * sizeof(ControlPoint));
+    if (record.hasFit) {
+        AffineFit fit{};
+        for (int i = 0; i < 3; ++i) {
+            fit.paramsX(i) = record.paramsX[i];
+            fit.paramsY(i) = record.paramsY[i];
+        }
+        fit.rms = record.rms;
+        fit.inlierMask.resize(words);
+        std::memcpy(fit.inlierMask.data(), base + header.maskOffset + record.maskBegin * sizeof(uint64_t),
+                    words * sizeof(uint64_t));
+        pageMapping->fit = std::move(fit);
+    }
+    return pageMapping;
+}
@@ -0,0 +1,46 @@
+#ifndef CHARTNAVIGATION_TBINFILE_HPP
+#define CHARTNAVIGATION_TBINFILE_HPP
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "pageMapping.hpp"
+
+/**
+ * 编译后的映射文件(.Tbin),内存映射后无需解析
+ * [头][航图槽(开放寻址,键为名字哈希)][航图表][页索引(按页码)][页表][控制点][内点位掩码][航图名]
+ * 查找航图与页均为常数时间;头中记录源 .Tmap 的大小/修改时间/哈希,不一致时视为过期
+ */
+class TbinFile {
+    public:
+        static bool compile (const std::filesystem::path &tmapPath, const std::filesystem::path &tbinPath,
+                             uint64_t seed = 1);
+
+        bool open (const std::filesystem::path &tbinPath, const std::filesystem::path &tmapPath);
+        void close ();
+        [[nodiscard]] bool isOpen () const { return base != nullptr; }
+        [[nodiscard]] std::optional<ChartMapping> chart (const std::string &chartName) const;
+        [[nodiscard]] std::map<std::string, ChartMapping> charts () const;
+        [[nodiscard]] std::shared_ptr<const PageMapping> page (const std::string &chartName, int pageNum) const;
+    private:
+        struct Header;
+        struct ChartRecord;
+        struct PageRecord;
+
+        boost::interprocess::file_mapping file;
+        boost::interprocess::mapped_region region;
+        const std::byte *base{nullptr};
+        size_t size{0};
+
+        template <typename T>
+        [[nodiscard]] T at (uint64_t offset, size_t index = 0) const;
+        [[nodiscard]] std::optional<ChartRecord> findChart (const std::string &chartName) const;
+        [[nodiscard]] ChartMapping readChart (const ChartRecord &record) const;
+        [[nodiscard]] std::shared_ptr<const PageMapping> readPage (uint32_t pageIndex) const;
+};
+
+#endif //CHARTNAVIGATION_TBINFILE_HPP
@@ -0,0 +1,343 @@
+#include "trackArchive.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <ranges>
+
+namespace
+{
+constexpr char MAGIC[4]{'T', 'R', 'K', 'A'};
+constexpr uint8_t VERSION{1};
+constexpr size_t HEADER_SIZE{5};
+constexpr uint8_t KEY_FRAME{'K'}, DELTA_FRAME{'D'};
+constexpr int64_t KEY_INTERVAL{30'000}; // 关键帧间隔(毫秒)
+// 量化精度
+constexpr double LAT_LON_SCALE{1e7}; // 约1厘米
+constexpr double ALT_SCALE{10}; // 0.1米
+constexpr double TRK_SCALE{100}; // 0.01度
+constexpr int64_t TRK_RANGE{36'000};
+
+void writeVarint (std::vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeSigned (std::vector<uint8_t> &out, const int64_t value) {
+    writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); // zigzag
+}
+
+bool readVarint (const std::vector<uint8_t> &in, size_t &pos, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size())
+            return false;
+        const uint8_t byte = in[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool readSigned (const std::vector<uint8_t> &in, size_t &pos, int64_t &value) {
+    uint64_t raw;
+    if (!readVarint(in, pos, raw))
+        return false;
+    value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    return true;
+}
+
+/**
+ * @brief 航向差分折算到 [-180,180) 度,跨越北向时差分仍很小
+ */
+int64_t wrapTrack (const int64_t delta) {
+    int64_t wrapped = ((delta % TRK_RANGE) + TRK_RANGE) % TRK_RANGE;
+    if (wrapped >= TRK_RANGE / 2)
+        wrapped -= TRK_RANGE;
+    return wrapped;
+}
+
+std::string indexPath (const std::string &path) {
+    return std::filesystem::path(path).replace_extension(".tidx").string();
+}
+}
+
+
+TrackWriter::~TrackWriter () {
+    close();
+}
+
+/**
+ * @brief 打开(追加)存档
+ * @param path 存档路径
+ * @return 是否成功
+ */
+bool TrackWriter::open (const std::string &path) {
+    close();
+    const bool exists = std::filesystem::exists(path);
+    file.open(path, std::ios::binary | std::ios::app);
+    index.open(indexPath(path), std::ios::binary | std::ios::app);
+    if (!file.is_open() || !index.is_open()) {
+        close();
+        return false;
+    }
+    if (!exists) {
+        file.write(MAGIC, sizeof(MAGIC));
+        file.put(static_cast<char>(VERSION));
+    }
+    offset = std::filesystem::file_size(path);
+    if (offset < HEADER_SIZE)
+        offset = HEADER_SIZE;
+    hasFrame = false; // 追加时以关键帧开始
+    return true;
+}
+
+/**
+ * @brief 追加一帧
+ * @param timeMs 时间戳(毫秒,单调递增)
+ * @param points 该帧全部目标
+ */
+void TrackWriter::append (const int64_t timeMs, const std::span<const TrackPoint> points) {
+    if (!file.is_open())
+        return;
+    buffer.clear();
+    const bool isKey = !hasFrame || (timeMs - keyTime >= KEY_INTERVAL) || (timeMs < lastTime);
+    if (isKey) {
+        last.clear();
+        keyTime = timeMs;
+        buffer.push_back(KEY_FRAME);
+        writeVarint(buffer, static_cast<uint64_t>(timeMs));
+        // 稀疏索引
+        const TrackIndexEntry entry{timeMs, offset};
+        index.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        index.flush();
+    } else {
+        buffer.push_back(DELTA_FRAME);
+        writeVarint(buffer, static_cast<uint64_t>(timeMs - lastTime));
+    }
+    writeVarint(buffer, points.size());
+    for (const auto &point : points) {
+        const Quantized q{
+            std::llround(point.latitude * LAT_LON_SCALE), std::llround(point.longitude * LAT_LON_SCALE),
+            std::llround(point.alt * ALT_SCALE), std::llround(std::fmod(point.track + 360, 360) * TRK_SCALE) % TRK_RANGE
+        };
+        const auto it = last.find(point.id);
+        const Quantized prev = (it == last.end()) ? Quantized{} : it->second;
+        writeVarint(buffer, point.id);
+        writeSigned(buffer, q.lat - prev.lat);
+        writeSigned(buffer, q.lon - prev.lon);
+        writeSigned(buffer, q.alt - prev.alt);
+        writeSigned(buffer, wrapTrack(q.trk - prev.trk));
+        last[point.id] = q;
+    }
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    if (isKey)
+        file.flush();
+    offset += buffer.size();
+    lastTime = timeMs;
+    hasFrame = true;
+}
+
+void TrackWriter::close () {
+    if (file.is_open())
+        file.close();
+    if (index.is_open())
+        index.close();
+    last.clear();
+    hasFrame = false;
+}
+
+
+/**
+ * @brief 打开存档,载入稀疏索引(缺失或损坏时重建)
+ * @param path 存档路径
+ * @return 是否成功
+ */
+bool TrackReader::open (const std::string &path) {
+    data.clear();
+    keyIndex.clear();
+    state.clear();
+    cursorTime = -1;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    data.assign(std::istreambuf_iterator<char>(file), {});
+    if ((data.size() < HEADER_SIZE) || (std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) ||
+        (data[4] != VERSION)) {
+        data.clear();
+        return false;
+    }
+    // 索引
+    if (std::ifstream indexFile(indexPath(path), std::ios::binary); indexFile.is_open()) {
+        TrackIndexEntry entry{};
+        while (indexFile.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+            if ((entry.offset >= data.size()) || (data[entry.offset] != KEY_FRAME) ||
+                (!keyIndex.empty() && entry.time < keyIndex.back().time))
+                break;
+            keyIndex.push_back(entry);
+        }
+    }
+    if (keyIndex.empty() && !rebuildIndex())
+        return false;
+    // 结束时间:从最后一个完整的关键帧解码至末尾
+    size_t pos{};
+    int64_t time{};
+    while (!keyIndex.empty()) {
+        pos = keyIndex.back().offset;
+        state.clear();
+        if (readFrame(pos, time))
+            break;
+        keyIndex.pop_back(); // 末尾写了一半的关键帧
+    }
+    if (keyIndex.empty()) {
+        data.clear();
+        return false;
+    }
+    lastFrameTime = time;
+    while ((pos < data.size()) && readFrame(pos, time))
+        lastFrameTime = time;
+    if (pos < data.size()) // 末尾可能是写了一半的帧
+        data.resize(pos);
+    // 扫描结束时间移动了游标,复位后首次查询从关键帧解码
+    state.clear();
+    cursor = HEADER_SIZE;
+    cursorTime = -1;
+    return true;
+}
+
+int64_t TrackReader::beginTime () const {
+    return keyIndex.empty() ? 0 : keyIndex.front().time;
+}
+
+int64_t TrackReader::endTime () const {
+    return lastFrameTime;
+}
+
+/**
+ * @brief 获取某一时刻的全部目标
+ * @param timeMs 目标时间(毫秒)
+ * @param frameTime 实际帧时间(不晚于目标时间的最后一帧)
+ * @param points 目标列表
+ * @return 是否存在该时刻之前的帧
+ * @note 二分查找关键帧后向前解码,顺序播放时沿用游标
+ */
+bool TrackReader::stateAt (const int64_t timeMs, int64_t &frameTime, std::vector<TrackPoint> &points) {
+    if (keyIndex.empty() || (timeMs < keyIndex.front().time))
+        return false;
+    const auto key = std::ranges::upper_bound(keyIndex, timeMs, {}, &TrackIndexEntry::time) - 1;
+    // 游标在同一关键帧区间内且不晚于目标时间,则继续解码
+    if ((cursorTime < key->time) || (cursorTime > timeMs)) {
+        cursor = key->offset;
+        cursorTime = -1;
+        state.clear();
+        int64_t time{};
+        if (!readFrame(cursor, time))
+            return false;
+        cursorTime = time;
+    }
+    while (cursor < data.size()) {
+        size_t pos = cursor;
+        int64_t time{};
+        // 先只读时间,超过目标时间则停止
+        if (data[pos] == KEY_FRAME) {
+            uint64_t absolute;
+            ++pos;
+            if (!readVarint(data, pos, absolute))
+                break;
+            time = static_cast<int64_t>(absolute);
+        } else {
+            uint64_t delta;
+            ++pos;
+            if (!readVarint(data, pos, delta))
+                break;
+            time = cursorTime + static_cast<int64_t>(delta);
+        }
+        if (time > timeMs)
+            break;
+        if (!readFrame(cursor, time))
+            break;
+        cursorTime = time;
+    }
+    // 输出当前帧存在的目标
+    frameTime = cursorTime;
+    points.clear();
+    for (const auto &[id, q] : state) {
+        if (!q.present)
+            continue;
+        points.emplace_back(id, static_cast<double>(q.lat) / LAT_LON_SCALE,
+                            static_cast<double>(q.lon) / LAT_LON_SCALE, static_cast<double>(q.alt) / ALT_SCALE,
+                            static_cast<double>(q.trk) / TRK_SCALE);
+    }
+    std::ranges::sort(points, {}, &TrackPoint::id);
+    return true;
+}
+
+/**
+ * @brief 解码一帧并更新状态
+ * @param pos 帧起始,成功后指向下一帧
+ * @param time 帧时间
+ * @return 是否成功
+ */
+bool TrackReader::readFrame (size_t &pos, int64_t &time) {
+    size_t p = pos;
+    if (p >= data.size())
+        return false;
+    const uint8_t tag = data[p++];
+    uint64_t rawTime, count;
+    if (!readVarint(data, p, rawTime))
+        return false;
+    if (tag == KEY_FRAME) {
+        state.clear();
+        time = static_cast<int64_t>(rawTime);
+    } else if (tag == DELTA_FRAME)
+        time = cursorTime + static_cast<int64_t>(rawTime);
+    else
+        return false;
+    if (!readVarint(data, p, count))
+        return false;
+    // 先标记全部目标为不存在(保留量化值作为差分基准)
+    for (auto &q : state | std::views::values)
+        q.present = false;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t id;
+        int64_t dLat, dLon, dAlt, dTrk;
+        if (!readVarint(data, p, id) || !readSigned(data, p, dLat) || !readSigned(data, p, dLon) ||
+            !readSigned(data, p, dAlt) || !readSigned(data, p, dTrk))
+            return false;
+        auto &q = state[static_cast<uint32_t>(id)];
+        q.lat += dLat;
+        q.lon += dLon;
+        q.alt += dAlt;
+        q.trk = ((q.trk + dTrk) % TRK_RANGE + TRK_RANGE) % TRK_RANGE;
+        q.present = true;
+    }
+    pos = p;
+    cursorTime = time;
+    return true;
+}
+
+/**
+ * @brief 扫描全文件重建关键帧索引
+ */
+bool TrackReader::rebuildIndex () {
+    keyIndex.clear();
+    state.clear();
+    size_t pos = HEADER_SIZE;
+    int64_t time{};
+    while (pos < data.size()) {
+        const size_t start = pos;
+        const bool isKey = data[pos] == KEY_FRAME;
+        if (!readFrame(pos, time))
+            break;
+        if (isKey)
+            keyIndex.emplace_back(time, start);
+    }
+    state.clear();
+    cursorTime = -1;
+    return !keyIndex.empty();
+}
@@ -0,0 +1,79 @@
+#ifndef CHARTNAVIGATION_TRACKARCHIVE_HPP
+#define CHARTNAVIGATION_TRACKARCHIVE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 航迹存档格式 (.trk)
+ * 文件头 "TRKA" + 版本(1字节)
+ * 帧  [标记 'K'关键帧 / 'D'差分帧][时间 varint,关键帧为绝对毫秒,差分帧为与上一帧间隔][目标数 varint]
+ *     每个目标 [id varint][纬度 经度 高度 航向 zigzag-varint 差分]
+ * 差分相对同一目标在上一帧的量化值,关键帧相对0(即绝对值),关键帧按固定间隔出现
+ * 稀疏时间索引 (.tidx) 每个关键帧一条 {int64 时间, uint64 偏移},随存档追加
+ */
+
+struct TrackPoint {
+    uint32_t id; // 目标编号(TCAS槽位,0为自身)
+    double latitude, longitude; // 纬度 经度
+    double alt, track; // 高度(米) 航向
+};
+
+struct TrackIndexEntry {
+    int64_t time; // 关键帧时间(毫秒)
+    uint64_t offset; // 关键帧在存档中的偏移
+};
+
+class TrackWriter {
+    public:
+        TrackWriter () = default;
+        ~TrackWriter ();
+        TrackWriter (const TrackWriter &) = delete;
+        TrackWriter& operator= (const TrackWriter &) = delete;
+
+        bool open (const std::string &path);
+        void append (int64_t timeMs, std::span<const TrackPoint> points);
+        void close ();
+        [[nodiscard]] bool isOpen () const { return file.is_open(); }
+    private:
+        struct Quantized {
+            int64_t lat, lon, alt, trk;
+        };
+
+        std::ofstream file, index;
+        std::vector<uint8_t> buffer; // 当前帧编码缓冲
+        std::unordered_map<uint32_t, Quantized> last; // 上一帧的量化值
+        int64_t lastTime{0}, keyTime{0};
+        uint64_t offset{0};
+        bool hasFrame{false};
+};
+
+class TrackReader {
+    public:
+        bool open (const std::string &path);
+        [[nodiscard]] int64_t beginTime () const;
+        [[nodiscard]] int64_t endTime () const;
+        bool stateAt (int64_t timeMs, int64_t &frameTime, std::vector<TrackPoint> &points);
+    private:
+        struct Quantized {
+            int64_t lat, lon, alt, trk;
+            bool present; // 是否在当前帧中
+        };
+
+        std::vector<uint8_t> data; // 整个存档
+        std::vector<TrackIndexEntry> keyIndex; // 稀疏时间索引
+        int64_t lastFrameTime{0};
+        // 顺序播放时的解码游标
+        size_t cursor{0};
+        int64_t cursorTime{-1};
+        std::unordered_map<uint32_t, Quantized> state;
+
+        bool readFrame (size_t &pos, int64_t &time);
+        bool rebuildIndex ();
+};
+
+#endif //CHARTNAVIGATION_TRACKARCHIVE_HPP
@@ -0,0 +1,149 @@
+#include "transformCache.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <thread>
+
+#include "tools/hash.hpp"
+
+namespace
+{
+constexpr char MAGIC[4]{'A', 'F', 'I', 'T'};
+constexpr uint8_t VERSION{2};
+
+/**
+ * @brief 每个写入者独占的临时文件名(界面线程与线程池可能同时写同一个键)
+ */
+std::string tempPath (const std::string &path) {
+    static std::atomic<uint64_t> counter{0};
+    return std::format("{}.{:x}-{}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()),
+                       counter.fetch_add(1, std::memory_order_relaxed));
+}
+
+template <typename T>
+void write (std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read (std::ifstream &file, T &value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+}
+
+
+/**
+ * @param directory 缓存目录(为空时只缓存在内存中)
+ */
+TransformCache::TransformCache (std::string directory) : directory(std::move(directory)) {}
+
+void TransformCache::setDirectory (std::string dir) {
+    directory = std::move(dir);
+}
+
+/**
+ * @brief 计算缓存键
+ * @param data 控制点
+ * @param threshold 筛选阈值
+ * @note 包含格式版本,算法改动时递增 VERSION 即可使旧缓存失效
+ */
+uint64_t TransformCache::key (const std::span<const ControlPoint> data, const double threshold) {
+    uint64_t hash = FNV_OFFSET;
+    hash = fnv1a(hash, &VERSION, sizeof(VERSION));
+    hash = fnv1a(hash, &threshold, sizeof(threshold));
+    const size_t size = data.size();
+    hash = fnv1a(hash, &size, sizeof(size));
+    hash = fnv1a(hash, data.data(), data.size_bytes()); // 连续存储,整块哈希
+    return hash;
+}
+
+/**
+ * @brief 查询缓存(内存优先,其次磁盘)
+ * @param key 缓存键
+ * @param pointCount 控制点数量(校验用)
+ * @param fit 结果
+ * @return 是否命中
+ */
+bool TransformCache::load (const uint64_t key, const size_t pointCount, AffineFit &fit) {
+    const size_t words = (pointCount + 63) / 64;
+    if (const auto it = memory.find(key); it != memory.end()) {
+        if (it->second.inlierMask.size() != words)
+            return false;
+        fit = it->second;
+        return true;
+    }
+    if (directory.empty())
+        return false;
+    std::ifstream file(filePath(key), std::ios::binary);
+    if (!file.is_open())
+        return false;
+    char magic[4];
+    uint8_t version;
+    uint32_t count;
+    AffineFit result{};
+    if (!file.read(magic, sizeof(magic)) || (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) ||
+        !read(file, version) || (version != VERSION))
+        return false;
+    for (int i = 0; i < 3; ++i)
+        if (!read(file, result.paramsX(i)))
+            return false;
+    for (int i = 0; i < 3; ++i)
+        if (!read(file, result.paramsY(i)))
+            return false;
+    if (!read(file, result.rms) || !read(file, count) || (count != pointCount))
+        return false;
+    result.inlierMask.resize(words);
+    if (!file.read(reinterpret_cast<char*>(result.inlierMask.data()),
+                   static_cast<std::streamsize>(words * sizeof(uint64_t))))
+        return false;
+    memory[key] = result;
+    fit = std::move(result);
+    return true;
+}
+
+/**
+ * @brief 写入缓存
+ * @param key 缓存键
+ * @param pointCount 控制点数量
+ * @param fit 结果
+ */
+void TransformCache::store (const uint64_t key, const size_t pointCount, const AffineFit &fit) {
+    memory[key] = fit;
+    if (directory.empty())
+        return;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    // 先写临时文件再改名,避免中断留下半个文件;同一键的并发写入各写各的临时文件,改名原子替换
+    const std::string path = filePath(key);
+    const std::string temp = tempPath(path);
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return;
+        file.write(MAGIC, sizeof(MAGIC));
+        write(file, VERSION);
+        for (int i = 0; i < 3; ++i)
+            write(file, fit.paramsX(i));
+        for (int i = 0; i < 3; ++i)
+            write(file, fit.paramsY(i));
+        write(file, fit.rms);
+        write(file, static_cast<uint32_t>(pointCount));
+        file.write(reinterpret_cast<const char*>(fit.inlierMask.data()),
+                   static_cast<std::streamsize>(fit.inlierMask.size() * sizeof(uint64_t)));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec)
+        std::filesystem::remove(temp, ec);
+}
+
+std::string TransformCache::filePath (const uint64_t key) const {
+    return (std::filesystem::path(directory) / std::format("{:016x}.fit", key)).string();
+}
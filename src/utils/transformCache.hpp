@@ -0,0 +1,30 @@
+#ifndef CHARTNAVIGATION_TRANSFORMCACHE_HPP
+#define CHARTNAVIGATION_TRANSFORMCACHE_HPP
+
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "affineTransformer.hpp"
+
+/**
+ * 仿射拟合结果缓存,键为页面控制点与阈值的哈希
+ * 每个键一个文件 <键>.fit
+ * [ "AFIT" ][版本 1字节][x参数 3*double][y参数 3*double][RMS double][点数 uint32][内点位掩码 uint64*字数]
+ */
+class TransformCache {
+    public:
+        explicit TransformCache (std::string directory = {});
+        void setDirectory (std::string directory);
+        static uint64_t key (std::span<const ControlPoint> data, double threshold);
+        bool load (uint64_t key, size_t pointCount, AffineFit &fit);
+        void store (uint64_t key, size_t pointCount, const AffineFit &fit);
+    private:
+        std::string directory;
+        std::unordered_map<uint64_t, AffineFit> memory;
+
+        [[nodiscard]] std::string filePath (uint64_t key) const;
+};
+
+#endif //CHARTNAVIGATION_TRANSFORMCACHE_HPP
@@ -0,0 +1,83 @@
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "utils/controlPointExtractor.hpp"
+
+/**
+ * 坐标解析测试: 符号格式(前/后置半球,ASCII与′″)、紧凑格式(度分/度分秒,带小数)、南纬西经、越界与非法输入
+ * 用法: CoordinateParserTest
+ */
+
+namespace
+{
+int failures{0};
+
+void check (const bool condition, const std::string &what) {
+    if (condition)
+        return;
+    std::cerr << "FAIL: " << what << '\n';
+    ++failures;
+}
+
+void expect (const QString &text, const double value, const bool latitude) {
+    bool isLatitude{!latitude};
+    const auto parsed = parseCoordinate(text, isLatitude);
+    const std::string name = text.toStdString();
+    if (!parsed) {
+        check(false, std::format("{}: rejected", name));
+        return;
+    }
+    check(std::abs(*parsed - value) < 1e-9, std::format("{}: {} != {}", name, *parsed, value));
+    check(isLatitude == latitude, std::format("{}: wrong axis", name));
+}
+
+void reject (const QString &text) {
+    bool isLatitude{};
+    check(!parseCoordinate(text, isLatitude), std::format("{}: accepted", text.toStdString()));
+}
+}
+
+
+int main () {
+    // 符号格式
+    expect(R"(N29°45'07.5")", 29 + 45.0 / 60 + 7.5 / 3600, true);
+    expect("29°45.1'N", 29 + 45.1 / 60, true);
+    expect("E106°39′11″", 106 + 39.0 / 60 + 11.0 / 3600, false);
+    expect("S33° 56'", -(33 + 56.0 / 60), true);
+    expect("106°39'11\"W", -(106 + 39.0 / 60 + 11.0 / 3600), false);
+    // 紧凑格式
+    expect("N2945", 29 + 45.0 / 60, true);
+    expect("N294507.5", 29 + 45.0 / 60 + 7.5 / 3600, true);
+    expect("2945.5N", 29 + 45.5 / 60, true);
+    expect("1063911E", 106 + 39.0 / 60 + 11.0 / 3600, false);
+    expect("W07330.5", -(73 + 30.5 / 60), false);
+    expect("S335600", -(33 + 56.0 / 60), true);
+    // 边界
+    expect("N90°00'", 90, true);
+    expect("W180°00'00\"", -180, false);
+    expect("  E1800000  ", 180, false);
+    // 越界
+    reject("N90°30'");
+    reject("S9000.1");
+    reject(R"(E180°00'01")");
+    reject("1800100W");
+    reject("N29°60'");
+    reject("N29°45'60\"");
+    reject("N296000");
+    // 非法
+    reject("");
+    reject("2945");
+    reject("N29°");
+    reject("N29451");
+    reject("E1063");
+
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "coordinate parser: ok\n";
+    return 0;
+}
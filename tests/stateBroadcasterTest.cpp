@@ -0,0 +1,154 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/beast/websocket.hpp>
+
+#include "utils/stateBroadcaster.hpp"
+
+/**
+ * 局域网广播测试(本机回环客户端)
+ * 1. 连接后先收到全量帧,之后为差分帧(变化/消失)
+ * 2. 一个客户端停止读取时,另一个客户端不被拖慢;停止的客户端恢复后补发全量帧
+ * 用法: StateBroadcasterTest
+ */
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+
+namespace
+{
+int failures{0};
+
+void check (const bool condition, const std::string &what) {
+    if (condition)
+        return;
+    std::cerr << "FAIL: " << what << '\n';
+    ++failures;
+}
+
+struct Frame {
+    char type;
+    uint32_t sequence;
+    std::vector<std::pair<uint16_t, int32_t>> changed; // id, 纬度
+    std::vector<uint16_t> removed;
+};
+
+template <typename T>
+T take (const std::string &bytes, size_t &pos) {
+    T value;
+    std::memcpy(&value, bytes.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+Frame decode (const std::string &bytes) {
+    size_t pos{1};
+    Frame frame{bytes[0], take<uint32_t>(bytes, pos)};
+    const auto changed = take<uint16_t>(bytes, pos), removed = take<uint16_t>(bytes, pos);
+    for (uint16_t i = 0; i < changed; ++i) {
+        const auto id = take<uint16_t>(bytes, pos);
+        frame.changed.emplace_back(id, take<int32_t>(bytes, pos));
+        pos += 4 + 2 + 2; // 经度 高度 航向
+    }
+    for (uint16_t i = 0; i < removed; ++i)
+        frame.removed.push_back(take<uint16_t>(bytes, pos));
+    return frame;
+}
+
+class Client {
+    public:
+        explicit Client (const unsigned short port) {
+            beast::get_lowest_layer(ws).connect({asio::ip::make_address("127.0.0.1"), port});
+            ws.handshake("127.0.0.1", "/");
+        }
+        Frame read () {
+            beast::flat_buffer buffer;
+            ws.read(buffer);
+            return decode(beast::buffers_to_string(buffer.cdata()));
+        }
+    private:
+        asio::io_context io;
+        websocket::stream<asio::ip::tcp::socket> ws{io};
+};
+
+std::vector<TrackPoint> targets (const size_t count, const int step) {
+    std::vector<TrackPoint> points;
+    for (size_t i = 0; i < count; ++i)
+        points.push_back({static_cast<uint32_t>(i), 30 + step * 1e-5 + i * 1e-4, 100 + i * 1e-4, 1000, 90});
+    return points;
+}
+
+void testFrames () {
+    StateBroadcaster broadcaster(0);
+    broadcaster.publish(targets(2, 0)); // 序号 1
+    Client client(broadcaster.port());
+    const Frame full = client.read();
+    check((full.type == 'F') && (full.sequence == 1) && (full.changed.size() == 2) && full.removed.empty(),
+          "full frame on connect");
+    // 只有目标1移动
+    auto points = targets(2, 0);
+    points[1].latitude += 1e-3;
+    broadcaster.publish(points); // 序号 2
+    const Frame moved = client.read();
+    check((moved.type == 'D') && (moved.sequence == 2) && (moved.changed.size() == 1) &&
+          (moved.changed[0].first == 1) && (moved.changed[0].second == std::lround(points[1].latitude * 1e7)) &&
+          moved.removed.empty(), "delta frame with the moved target");
+    broadcaster.publish(points); // 序号 3,无变化不发送
+    points.erase(points.begin());
+    broadcaster.publish(points); // 序号 4,目标0消失
+    const Frame removed = client.read();
+    check((removed.type == 'D') && (removed.sequence == 4) && removed.changed.empty() &&
+          (removed.removed == std::vector<uint16_t>{0}), "delta frame with the removed target");
+}
+
+void testStalledClient () {
+    constexpr size_t COUNT{5000}; // 每帧约 70KB,远超套接字缓冲
+    constexpr int FRAMES{400};
+    StateBroadcaster broadcaster(0);
+    Client fast(broadcaster.port()), stalled(broadcaster.port());
+    check(fast.read().type == 'F', "fast client full frame");
+    check(stalled.read().type == 'F', "stalled client full frame");
+    // 快客户端持续读取,记录收到最后一帧的时刻
+    std::atomic<std::chrono::steady_clock::time_point> fastDone{};
+    std::thread reader([&] {
+        try {
+            while (fast.read().sequence != FRAMES) {}
+            fastDone = std::chrono::steady_clock::now();
+        } catch (const boost::system::system_error &) {}
+    });
+    for (int i = 1; i <= FRAMES; ++i)
+        broadcaster.publish(targets(COUNT, i));
+    const auto published = std::chrono::steady_clock::now();
+    reader.join();
+    const auto lag = std::chrono::duration_cast<std::chrono::milliseconds>(fastDone.load() - published).count();
+    check(fastDone.load() != std::chrono::steady_clock::time_point{}, "fast client reached the last frame");
+    check(lag < 2000, std::format("fast client lagged {} ms behind a stalled one", lag));
+    // 停止的客户端恢复: 丢弃期间的差分,最终收到一次全量帧
+    bool resynced{false};
+    for (int i = 0; i < FRAMES + 2; ++i) {
+        const Frame frame = stalled.read();
+        resynced |= frame.type == 'F';
+        if (frame.sequence == FRAMES)
+            break;
+    }
+    check(resynced, "stalled client resynchronised with a full frame");
+}
+}
+
+
+int main () {
+    testFrames();
+    testStalledClient();
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "state broadcaster: ok\n";
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <vector>
+
+#include "utils/trackArchive.hpp"
+
+/**
+ * 航迹存档往返测试: 写入 -> 重新打开 -> 定位到开始/中间/结束,追加,末尾截断
+ * 用法: TrackArchiveTest [临时文件夹=系统临时目录]
+ */
+
+namespace
+{
+int failures{0};
+
+void check (const bool condition, const std::string &what) {
+    if (condition)
+        return;
+    std::cerr << "FAIL: " << what << '\n';
+    ++failures;
+}
+
+/**
+ * @brief 第 i 帧的目标(两个目标,第二个每隔一帧缺席)
+ */
+std::vector<TrackPoint> framePoints (const int i) {
+    std::vector<TrackPoint> points{{0, 30 + i * 1e-4, 100 + i * 2e-4, 1000.0 + i, std::fmod(350.0 + i, 360.0)}};
+    if (i % 2 == 0)
+        points.push_back({7, 31 - i * 1e-4, 101 - i * 1e-4, 2000.0 - i, std::fmod(10.0 + 3 * i, 360.0)});
+    return points;
+}
+
+/**
+ * @brief 在 timeMs 读到的状态应为第 frame 帧
+ */
+void expectFrame (TrackReader &reader, const int64_t timeMs, const int frame, const int64_t frameStep,
+                  const std::string &what) {
+    int64_t frameTime{-1};
+    std::vector<TrackPoint> points;
+    if (!reader.stateAt(timeMs, frameTime, points)) {
+        check(false, what + ": stateAt failed");
+        return;
+    }
+    const auto expected = framePoints(frame);
+    check(frameTime == frame * frameStep, std::format("{}: frame time {} != {}", what, frameTime, frame * frameStep));
+    check(points.size() == expected.size(), std::format("{}: {} points != {}", what, points.size(), expected.size()));
+    for (size_t i = 0; i < std::min(points.size(), expected.size()); ++i) {
+        check(points[i].id == expected[i].id, what + ": id");
+        check(std::abs(points[i].latitude - expected[i].latitude) < 1e-6, what + ": latitude");
+        check(std::abs(points[i].longitude - expected[i].longitude) < 1e-6, what + ": longitude");
+        check(std::abs(points[i].alt - expected[i].alt) < 0.1, what + ": altitude");
+        check(std::abs(points[i].track - expected[i].track) < 0.01, what + ": track");
+    }
+}
+}
+
+
+int main (int argc, char *argv[]) {
+    const std::filesystem::path folder = argc > 1 ? argv[1] : std::filesystem::temp_directory_path();
+    const auto path = (folder / "trackArchiveTest.trk").string();
+    const auto clean = [&] {
+        std::filesystem::remove(path);
+        std::filesystem::remove(std::filesystem::path(path).replace_extension(".tidx"));
+    };
+    constexpr int64_t STEP{100};
+
+    // 单帧存档,刚打开即查询结束时间
+    clean();
+    {
+        TrackWriter writer;
+        check(writer.open(path), "open writer");
+        writer.append(0, framePoints(0));
+    }
+    {
+        TrackReader reader;
+        check(reader.open(path), "open single-frame archive");
+        check(reader.endTime() == 0, "single-frame end time");
+        expectFrame(reader, reader.endTime(), 0, STEP, "single frame at end");
+    }
+
+    // 多帧(跨越多个关键帧间隔),再追加一段
+    clean();
+    constexpr int FIRST{700}, TOTAL{1000};
+    {
+        TrackWriter writer;
+        check(writer.open(path), "open writer");
+        for (int i = 0; i < FIRST; ++i)
+            writer.append(i * STEP, framePoints(i));
+    }
+    {
+        TrackWriter writer;
+        check(writer.open(path), "reopen writer for append");
+        for (int i = FIRST; i < TOTAL; ++i)
+            writer.append(i * STEP, framePoints(i));
+    }
+    {
+        TrackReader reader;
+        check(reader.open(path), "open archive");
+        check(reader.beginTime() == 0, "begin time");
+        check(reader.endTime() == (TOTAL - 1) * STEP, "end time");
+        expectFrame(reader, reader.endTime(), TOTAL - 1, STEP, "end right after open");
+        expectFrame(reader, 0, 0, STEP, "begin");
+        expectFrame(reader, 31'234, 312, STEP, "middle");
+        expectFrame(reader, 31'555, 315, STEP, "sequential forward");
+        expectFrame(reader, 12'000, 120, STEP, "seek backward");
+        expectFrame(reader, FIRST * STEP + 50, FIRST, STEP, "first appended frame");
+        expectFrame(reader, reader.endTime() + 5'000, TOTAL - 1, STEP, "after end");
+        int64_t frameTime;
+        std::vector<TrackPoint> points;
+        check(!reader.stateAt(-1, frameTime, points), "before begin");
+    }
+
+    // 末尾写了一半的帧: 丢弃该帧,其余可读
+    const auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 3);
+    {
+        TrackReader reader;
+        check(reader.open(path), "open truncated archive");
+        check(reader.endTime() == (TOTAL - 2) * STEP, "truncated end time");
+        expectFrame(reader, reader.endTime(), TOTAL - 2, STEP, "truncated end");
+        expectFrame(reader, 31'234, 312, STEP, "truncated middle");
+    }
+
+    // 末尾写了一半的关键帧(索引已指向它)
+    clean();
+    {
+        TrackWriter writer;
+        check(writer.open(path), "open writer");
+        for (int i = 0; i < 10; ++i)
+            writer.append(i * STEP, framePoints(i));
+    }
+    const auto keyStart = std::filesystem::file_size(path);
+    {
+        TrackWriter writer;
+        check(writer.open(path), "reopen writer");
+        writer.append(10 * STEP, framePoints(10)); // 追加时以关键帧开始
+    }
+    std::filesystem::resize_file(path, keyStart + 2);
+    {
+        TrackReader reader;
+        check(reader.open(path), "open archive with truncated key frame");
+        check(reader.endTime() == 9 * STEP, "truncated key frame end time");
+        expectFrame(reader, 20 * STEP, 9, STEP, "truncated key frame end");
+    }
+
+    clean();
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "track archive: ok\n";
+    return 0;
+}
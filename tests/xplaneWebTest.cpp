@@ -0,0 +1,264 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "XPlaneWeb.hpp"
+
+/**
+ * Web API 传输测试
+ * 1. WebFrameReader: 数值/数组/base64/键乱序/非更新帧/非法帧
+ * 2. XPlaneWeb 对本机模拟服务器(REST + WebSocket): 名称解析,合并订阅,推送分发,非法帧不写入
+ * 用法: XPlaneWebTest
+ */
+
+using namespace eyderoe;
+
+namespace
+{
+int failures{0};
+
+void check (const bool condition, const std::string &what) {
+    if (condition)
+        return;
+    std::cerr << "FAIL: " << what << '\n';
+    ++failures;
+}
+
+struct Value {
+    int64_t id;
+    size_t idx;
+    float value;
+    bool operator== (const Value &) const = default;
+};
+
+/**
+ * @brief 读取一帧,返回是否合法及全部回调
+ */
+std::pair<bool, std::vector<Value>> readFrame (const std::string_view frame) {
+    std::vector<Value> values;
+    WebFrameReader reader(frame);
+    const bool ok = reader.readUpdate([&](const int64_t id, const size_t idx, const float value) {
+        values.push_back({id, idx, value});
+    });
+    return {ok, values};
+}
+
+void testReader () {
+    {
+        const auto [ok, values] = readFrame(R"({"type":"dataref_update_values","data":{"7":1.5,"8":-2e3}})");
+        check(ok && (values == std::vector<Value>{{7, 0, 1.5f}, {8, 0, -2000.0f}}), "scalar frame");
+    }
+    {
+        const auto [ok, values] = readFrame(R"({"type":"dataref_update_values","data":{"9":[1, 2.5 ,3],"10":[]}})");
+        check(ok && (values == std::vector<Value>{{9, 0, 1}, {9, 1, 2.5f}, {9, 2, 3}}), "array frame");
+    }
+    {
+        // "AQL/" = 0x01 0x02 0xFF
+        const auto [ok, values] = readFrame(R"({"type":"dataref_update_values","data":{"11":"AQL/"}})");
+        check(ok && (values == std::vector<Value>{{11, 0, 1}, {11, 1, 2}, {11, 2, 255}}), "base64 frame");
+    }
+    {
+        const auto [ok, values] = readFrame(
+            "{ \"data\" : {\"7\" : 4}, \"extra\":{\"a\":[1,{\"b\":\"}\"}]}, \"type\":\"dataref_update_values\" }");
+        check(ok && (values == std::vector<Value>{{7, 0, 4}}), "reordered keys");
+    }
+    for (const std::string_view frame : {
+             R"({"type":"result","req_id":1,"success":true})",
+             R"({"type":"dataref_update_values"})",
+             R"({})",
+         }) {
+        const auto [ok, values] = readFrame(frame);
+        check(!ok && values.empty(), std::format("non-update frame {}", frame));
+    }
+    for (const std::string_view frame : {
+             R"({"type":"dataref_update_values","data":{"7":1,"9":[1,null]}})",
+             R"({"type":"dataref_update_values","data":{"7":1,"11":"AQ*/"}})",
+             R"({"type":"dataref_update_values","data":{"7":1,"x":2}})",
+             R"({"type":"dataref_update_values","data":{"7":1,"8":2)",
+             R"({"type":"dataref_update_values","data":{"7":[1,2})",
+             R"({"type":"dataref_update_values","data":{"7":1 "8":2}})",
+             R"(not json)",
+         }) {
+        const auto [ok, values] = readFrame(frame);
+        check(!ok && values.empty(), std::format("malformed frame {}", frame));
+    }
+}
+
+/**
+ * 本机模拟 Web API: REST 按名称返回 id,WebSocket 收到订阅后依次推送 frames
+ * WebSocket 握手在 open() 之前挂起,保证客户端新增的目标在一次解析中完成
+ */
+class MockServer {
+    public:
+        explicit MockServer (std::vector<std::string> frames) : frames(std::move(frames)) {
+            acceptor.open(asio::ip::tcp::v4());
+            acceptor.bind({asio::ip::make_address("127.0.0.1"), 0});
+            acceptor.listen();
+            asio::co_spawn(io, listen(), asio::detached);
+            worker = std::thread([this] { io.run(); });
+        }
+        ~MockServer () {
+            io.stop();
+            worker.join();
+        }
+        [[nodiscard]] unsigned short port () const {
+            return acceptor.local_endpoint().port();
+        }
+        void open () {
+            opened = true;
+        }
+        [[nodiscard]] std::vector<std::string> requests () const {
+            const std::lock_guard lock(mutex);
+            return restTargets;
+        }
+        [[nodiscard]] std::vector<std::string> messages () const {
+            const std::lock_guard lock(mutex);
+            return received;
+        }
+    private:
+        const std::map<std::string, int64_t> ids{{"sim/foo", 7}, {"sim/bar", 8}, {"sim/baz", 9}, {"sim/bytes", 11}};
+        std::vector<std::string> frames;
+        asio::io_context io;
+        asio::ip::tcp::acceptor acceptor{io};
+        std::thread worker;
+        std::atomic_bool opened{false};
+        mutable std::mutex mutex;
+        std::vector<std::string> restTargets, received;
+
+        asio::awaitable<void> listen () {
+            while (true) {
+                auto socket = co_await acceptor.async_accept(asio::use_awaitable);
+                asio::co_spawn(io, serve(std::move(socket)), asio::detached);
+            }
+        }
+
+        asio::awaitable<void> serve (asio::ip::tcp::socket socket) {
+            try {
+                beast::flat_buffer buffer;
+                http::request<http::string_body> request;
+                co_await http::async_read(socket, buffer, request, asio::use_awaitable);
+                if (websocket::is_upgrade(request)) {
+                    asio::steady_timer timer(io);
+                    while (!opened) {
+                        timer.expires_after(std::chrono::milliseconds(10));
+                        co_await timer.async_wait(asio::use_awaitable);
+                    }
+                    websocket::stream<asio::ip::tcp::socket> ws(std::move(socket));
+                    co_await ws.async_accept(request, asio::use_awaitable);
+                    while (true) {
+                        beast::flat_buffer message;
+                        co_await ws.async_read(message, asio::use_awaitable);
+                        {
+                            const std::lock_guard lock(mutex);
+                            received.push_back(beast::buffers_to_string(message.cdata()));
+                        }
+                        ws.text(true);
+                        for (const auto &frame : frames)
+                            co_await ws.async_write(asio::buffer(frame), asio::use_awaitable);
+                    }
+                }
+                // REST: 按 filter[name] 返回 id
+                const std::string target(request.target());
+                {
+                    const std::lock_guard lock(mutex);
+                    restTargets.push_back(target);
+                }
+                nlohmann::json data = nlohmann::json::array();
+                const std::string filter = "filter%5Bname%5D=";
+                for (size_t pos = target.find(filter); pos != std::string::npos; pos = target.find(filter, pos)) {
+                    pos += filter.size();
+                    const std::string name = target.substr(pos, target.find('&', pos) - pos);
+                    if (const auto it = ids.find(name); it != ids.end())
+                        data.push_back({{"id", it->second}, {"name", name}});
+                }
+                http::response<http::string_body> response{http::status::ok, request.version()};
+                response.set(http::field::content_type, "application/json");
+                response.body() = nlohmann::json{{"data", data}}.dump();
+                response.prepare_payload();
+                co_await http::async_write(socket, response, asio::use_awaitable);
+            } catch (const boost::system::system_error &) {}
+        }
+};
+
+template <typename Func>
+bool waitFor (Func &&condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (condition())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+void testTransport () {
+    // 依次: 正常帧,中途出错的帧,非更新帧,最后一帧作为同步标记(bar = 5)
+    MockServer server({
+        R"({"type":"dataref_update_values","data":{"7":[1.5,2.5],"8":3,"9":[10,11,12,13],"11":"AQL/"}})",
+        R"({"type":"dataref_update_values","data":{"8":99,"9":[1,null]}})",
+        R"({"type":"result","req_id":1,"success":true})",
+        R"({"type":"dataref_update_values","data":{"8":5}})",
+    });
+    XPlaneWeb web("127.0.0.1", server.port(), false);
+    const auto foo0 = web.addDataref("sim/foo", 1, 0);
+    const auto foo3 = web.addDataref("sim/foo", 1, 3);
+    const auto bar = web.addDataref("sim/bar");
+    const auto baz = web.addDatarefArray("sim/baz", 4);
+    const auto baz2 = web.addDataref("sim/baz", 1, 2);
+    const auto bytes = web.addDatarefArray("sim/bytes", 3);
+    const auto missing = web.addDataref("sim/missing");
+    server.open();
+
+    float value{0};
+    check(waitFor([&] { return web.getDataref(bar, value) && (value == 5); }), "final frame received");
+    // 一次解析,一次订阅
+    const auto requests = server.requests();
+    check(requests.size() == 1, std::format("{} REST requests", requests.size()));
+    if (!requests.empty())
+        for (const auto name : {"sim/foo", "sim/bar", "sim/baz", "sim/bytes", "sim/missing"})
+            check(requests[0].find(std::format("filter%5Bname%5D={}", name)) != std::string::npos,
+                  std::format("resolve {}", name));
+    const auto messages = server.messages();
+    check(messages.size() == 1, std::format("{} subscribe messages", messages.size()));
+    if (!messages.empty()) {
+        const auto message = nlohmann::json::parse(messages[0], nullptr, false);
+        check(!message.is_discarded() && (message["type"] == "dataref_subscribe_values"), "subscribe type");
+        std::map<int64_t, nlohmann::json> items;
+        for (const auto &item : message["params"]["datarefs"])
+            items[item["id"].get<int64_t>()] = item;
+        check(items.size() == 4, "subscribe ids");
+        check(items[7].contains("index") && (items[7]["index"] == nlohmann::json{0, 3}), "foo merged indices");
+        check(!items[8].contains("index"), "bar whole");
+        check(!items[9].contains("index"), "baz whole (array and element)");
+        check(!items[11].contains("index"), "bytes whole");
+    }
+    // 推送分发
+    check(web.getDataref(foo0, value) && (value == 1.5f), "foo[0]");
+    check(web.getDataref(foo3, value) && (value == 2.5f), "foo[3]");
+    std::array<float, 4> array{};
+    check(web.getDataref(baz, array) && (array == std::array<float, 4>{10, 11, 12, 13}), "baz (malformed frame ignored)");
+    check(web.getDataref(baz2, value) && (value == 12), "baz[2]");
+    std::array<float, 3> byteArray{};
+    check(web.getDataref(bytes, byteArray) && (byteArray == std::array<float, 3>{1, 2, 255}), "bytes");
+    check(!web.getDataref(missing, value, -1) && (value == -1), "unresolved dataref");
+}
+}
+
+
+int main () {
+    testReader();
+    testTransport();
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "xplane web: ok\n";
+    return 0;
+}